@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "epoch.hpp"
+#include "locks.hpp"
+#include "node_pool.hpp"
+#include "thread_index.hpp"
+#ifndef lacpp_adaptive_list_hpp
+#define lacpp_adaptive_list_hpp lacpp_adaptive_list_hpp
+
+/* contention-adaptive sorted list
+ *
+ * One chain of nodes, two ways to synchronize on it:
+ *  - coarse: every operation holds one TATAS lock, as in sl_par_3.hpp;
+ *  - fine: the lazy list of sl_par_7.hpp (lock-free traversal, lock pred
+ *    and curr, validate, marked flag, epoch reclamation), with a one-byte
+ *    lock per node.
+ * The node layout serves both, so switching modes moves no data. A switch
+ * is a quiescent handover: the switching thread raises a flag that holds
+ * new operations at the door, waits until every operation in flight has
+ * left, flips the mode and lowers the flag. Operations announce themselves
+ * in a padded per-thread word, so entering costs one store and one load.
+ *
+ * The mode is chosen by measured throughput, not by guessing from
+ * contention. Every thread counts its operations and updates in its own
+ * slot; every CHECK_INTERVAL ops it looks at the clock, and once PERIOD
+ * has passed, one thread sums the slots and divides by the elapsed wall
+ * time. That figure is operations per second over all threads, so lock
+ * waits, the extra work of fine mode (two node locks, validation, epochs)
+ * and threads preempted while holding the coarse lock all show up in it,
+ * and the update share gives the operation mix.
+ *
+ * Switches are tryouts. When the other mode was never measured, was last
+ * measured more than explore_after periods ago, or under an operation mix
+ * more than MIX_DRIFT points away, the list switches over for MIN_STAY
+ * periods and compares it with the periods just before. The newcomer stays
+ * only if it was more than HYSTERESIS percent faster. A lost tryout costs
+ * a few periods in the worse mode, so the gap between tryouts doubles, up
+ * to EXPLORE_MAX periods, each time the current mode wins again.
+ */
+template<typename T, typename Alloc = heap_allocator>
+class adaptive_list {
+	enum class mode_kind {coarse, fine};
+
+	/* measurement period, in nanoseconds */
+	static const std::uint64_t PERIOD = 10000000;
+	/* ops of a thread between looks at the clock */
+	static const unsigned CHECK_INTERVAL = 64;
+	/* switch only to a mode that is this many percent faster */
+	static const unsigned HYSTERESIS = 10;
+	/* percentage points of update share after which an estimate is stale */
+	static const unsigned MIX_DRIFT = 25;
+	/* periods to stay in a mode before deciding again */
+	static const unsigned MIN_STAY = 4;
+	/* periods between tryouts of the other mode */
+	static const unsigned EXPLORE_MIN = 8;
+	static const unsigned EXPLORE_MAX = 256;
+
+	struct node {
+		T						value;
+		std::atomic<node*>		next{nullptr};
+		std::atomic<bool>		marked{false};
+		lacpp::byte_lock		mutex;
+	};
+
+	struct alignas(CACHELINE_SIZE) slot {
+		/* an operation of this thread is in flight */
+		std::atomic<bool>			active{false};
+		/* operations and updates so far, written by the owner only */
+		std::atomic<std::uint64_t>	ops{0};
+		std::atomic<std::uint64_t>	updates{0};
+	};
+
+	/* measured throughput of one mode; switch_mutex protects it */
+	struct estimate {
+		/* operations per second */
+		std::uint64_t	rate = 0;
+		/* update share, in percent */
+		unsigned		mix = 0;
+		/* period count when last measured, 0 for never */
+		std::uint64_t	measured = 0;
+	};
+
+	/* sentinel, its value is never looked at */
+	node				head;
+	lacpp::tatas_lock	coarse_lock;
+	epoch_domain		epoch;
+
+	alignas(CACHELINE_SIZE) std::atomic<mode_kind>	mode{mode_kind::coarse};
+	std::atomic<bool>	switching{false};
+	/* start of the current period, read by every thread */
+	std::atomic<std::uint64_t>	period_start{now()};
+	std::mutex			switch_mutex;
+	/* all below: switch_mutex */
+	std::uint64_t		period_ops = 0;
+	std::uint64_t		period_updates = 0;
+	estimate			estimates[2];
+	std::uint64_t		periods = 0;
+	/* period count when the current mode was entered */
+	std::uint64_t		entered = 0;
+	/* the current mode is being tried out */
+	bool				exploring = false;
+	std::uint64_t		explore_after = EXPLORE_MIN;
+	slot				slots[MAX_THREADS];
+
+	/* free a detached chain of nodes in one pass */
+	static void free_chain(node* current) {
+		while(current != nullptr) {
+			node* next = current->next.load(std::memory_order_relaxed);
+			Alloc::deallocate(current);
+			current = next;
+		}
+	}
+
+	/* announce an operation and return the mode it runs in */
+	mode_kind enter(slot& s) {
+		while(true) {
+			/* seq_cst store and load, paired with quiesce() */
+			s.active.store(true);
+			if(!switching.load()) {
+				return mode.load(std::memory_order_relaxed);
+			}
+			s.active.store(false, std::memory_order_release);
+			while(switching.load(std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void exit(slot& s) {
+		s.active.store(false, std::memory_order_release);
+	}
+
+	/* hold new operations off and wait for those in flight; switch_mutex
+	 * must be held and the caller must not be inside an operation
+	 */
+	void quiesce() {
+		switching.store(true);
+		std::size_t high = thread_index_registry::instance().high_water();
+		for(std::size_t i = 0; i < high; i++) {
+			while(slots[i].active.load()) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void resume() {
+		switching.store(false, std::memory_order_release);
+	}
+
+	/* run fn with no operation in flight */
+	template<typename F>
+	void exclusive(F fn) {
+		std::lock_guard<std::mutex> lock(switch_mutex);
+		quiesce();
+		fn();
+		resume();
+	}
+
+	static std::uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	static mode_kind other(mode_kind m) {
+		return m == mode_kind::coarse ? mode_kind::fine : mode_kind::coarse;
+	}
+
+	/* count one operation; every CHECK_INTERVAL ops, end the period if it
+	 * is over. Called after exit().
+	 */
+	void sample(slot& s, bool update) {
+		std::uint64_t n = s.ops.load(std::memory_order_relaxed) + 1;
+		s.ops.store(n, std::memory_order_relaxed);
+		if(update) {
+			s.updates.store(s.updates.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+		if(n % CHECK_INTERVAL != 0
+			|| now() - period_start.load(std::memory_order_relaxed) < PERIOD) {
+			return;
+		}
+		/* another thread is ending the period */
+		if(!switch_mutex.try_lock()) {
+			return;
+		}
+		decide();
+		switch_mutex.unlock();
+	}
+
+	/* measure the period that just ended and fold it into the estimate of
+	 * the current mode; end a tryout, or start one of the other mode if its
+	 * estimate is stale. switch_mutex must be held.
+	 */
+	void decide() {
+		std::uint64_t t = now();
+		std::uint64_t elapsed = t - period_start.load(std::memory_order_relaxed);
+		if(elapsed < PERIOD) {
+			/* ended by another thread meanwhile */
+			return;
+		}
+		std::uint64_t ops = 0, updates = 0;
+		std::size_t high = thread_index_registry::instance().high_water();
+		for(std::size_t i = 0; i < high; i++) {
+			ops += slots[i].ops.load(std::memory_order_relaxed);
+			updates += slots[i].updates.load(std::memory_order_relaxed);
+		}
+		std::uint64_t done = ops - period_ops;
+		unsigned mix = done == 0 ? 0 : 100 * (updates - period_updates) / done;
+		std::uint64_t rate = done * 1000000000 / elapsed;
+		period_start.store(t, std::memory_order_relaxed);
+		period_ops = ops;
+		period_updates = updates;
+
+		mode_kind m = mode.load(std::memory_order_relaxed);
+		periods++;
+		estimate& current = estimates[static_cast<int>(m)];
+		/* figures from before entering m are stale; one period is noisy, so
+		 * average over the last few
+		 */
+		current.rate = current.measured <= entered ? rate : (3 * current.rate + rate) / 4;
+		current.mix = mix;
+		current.measured = periods;
+		if(periods - entered < MIN_STAY) {
+			return;
+		}
+
+		const estimate& previous = estimates[static_cast<int>(other(m))];
+		if(exploring) {
+			/* a tried-out mode stays only if it beat the one before */
+			exploring = false;
+			if(100 * current.rate > (100 + HYSTERESIS) * previous.rate) {
+				explore_after = EXPLORE_MIN;
+			} else {
+				explore_after = std::min(2 * explore_after, static_cast<std::uint64_t>(EXPLORE_MAX));
+				switch_to(other(m));
+			}
+		} else if(previous.measured == 0
+			|| periods - previous.measured > explore_after
+			|| (mix > previous.mix ? mix - previous.mix : previous.mix - mix) > MIX_DRIFT) {
+			exploring = true;
+			switch_to(other(m));
+		}
+	}
+
+	/* quiescent handover to mode m; switch_mutex must be held */
+	void switch_to(mode_kind m) {
+		quiesce();
+		/* quiescent: no marked nodes are linked and no node lock is held */
+		mode.store(m, std::memory_order_relaxed);
+		entered = periods;
+		resume();
+	}
+
+	/* fine mode: find pred, curr with pred->value < v <= curr->value */
+	void find(T v, node*& pred, node*& curr) {
+		pred = &head;
+		curr = head.next.load();
+		while(curr != nullptr && curr->value < v) {
+			pred = curr;
+			curr = curr->next.load();
+		}
+	}
+
+	/* fine mode: pred and curr are still adjacent and live; both must be locked */
+	static bool validate(node* pred, node* curr) {
+		return !pred->marked.load()
+			&& (curr == nullptr || !curr->marked.load())
+			&& pred->next.load() == curr;
+	}
+
+	void insert_coarse(node* new_node) {
+		coarse_lock.lock();
+		std::atomic<node*>* link = &head.next;
+		node* succ = link->load(std::memory_order_relaxed);
+		while(succ != nullptr && succ->value < new_node->value) {
+			link = &succ->next;
+			succ = link->load(std::memory_order_relaxed);
+		}
+		new_node->next.store(succ, std::memory_order_relaxed);
+		link->store(new_node, std::memory_order_relaxed);
+		coarse_lock.unlock();
+	}
+
+	void insert_fine(node* new_node) {
+		epoch_guard guard(epoch);
+		while(true) {
+			node* pred;
+			node* curr;
+			find(new_node->value, pred, curr);
+			std::lock_guard<lacpp::byte_lock> pred_lock(pred->mutex);
+			if(!pred->marked.load() && pred->next.load() == curr) {
+				new_node->next.store(curr, std::memory_order_relaxed);
+				pred->next.store(new_node);
+				return;
+			}
+		}
+	}
+
+	void remove_coarse(T v) {
+		coarse_lock.lock();
+		std::atomic<node*>* link = &head.next;
+		node* curr = link->load(std::memory_order_relaxed);
+		while(curr != nullptr && curr->value < v) {
+			link = &curr->next;
+			curr = link->load(std::memory_order_relaxed);
+		}
+		if(curr != nullptr && curr->value == v) {
+			link->store(curr->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		} else {
+			curr = nullptr;
+		}
+		coarse_lock.unlock();
+		/* nobody walks the list without the lock in coarse mode */
+		if(curr != nullptr) {
+			Alloc::deallocate(curr);
+		}
+	}
+
+	void remove_fine(T v) {
+		epoch_guard guard(epoch);
+		while(true) {
+			node* pred;
+			node* curr;
+			find(v, pred, curr);
+			if(curr == nullptr || curr->value != v) {
+				/* v not found */
+				return;
+			}
+			std::lock_guard<lacpp::byte_lock> pred_lock(pred->mutex);
+			std::lock_guard<lacpp::byte_lock> curr_lock(curr->mutex);
+			if(validate(pred, curr)) {
+				/* logical, then physical deletion */
+				curr->marked.store(true);
+				pred->next.store(curr->next.load());
+				epoch.retire_to<Alloc>(curr);
+				return;
+			}
+		}
+	}
+
+	/* count v on a chain without marked nodes, or skipping them */
+	std::size_t count_from(node* curr, T v) {
+		while(curr != nullptr && curr->value < v) {
+			curr = curr->next.load();
+		}
+		std::size_t cnt = 0;
+		while(curr != nullptr && curr->value == v) {
+			if(!curr->marked.load()) {
+				cnt++;
+			}
+			curr = curr->next.load();
+		}
+		return cnt;
+	}
+
+public:
+	adaptive_list() = default;
+	adaptive_list(const adaptive_list&) = delete;
+	adaptive_list& operator=(const adaptive_list&) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * nodes are allocated in list order, so neighbours tend to be adjacent
+	 */
+	template<typename InputIt>
+	adaptive_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		std::atomic<node*>* link = &head.next;
+		for(auto& v : values) {
+			node* current = Alloc::template allocate<node>();
+			current->value = v;
+			link->store(current, std::memory_order_relaxed);
+			link = &current->next;
+		}
+	}
+	~adaptive_list() {
+		/* no concurrent users left: free the chain directly */
+		free_chain(head.next.load());
+	}
+
+	/* true while the list runs in fine-grained mode */
+	bool fine_grained() const {
+		return mode.load(std::memory_order_relaxed) == mode_kind::fine;
+	}
+
+	/* remove all elements with no operation in flight */
+	void clear() {
+		node* chain = nullptr;
+		exclusive([&] {
+			chain = head.next.load();
+			head.next.store(nullptr);
+		});
+		/* fine-mode readers that walked the chain are gone by now */
+		free_chain(chain);
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		/* construct new node */
+		node* new_node = Alloc::template allocate<node>();
+		new_node->value = v;
+
+		slot& s = slots[thread_index()];
+		mode_kind m = enter(s);
+		if(m == mode_kind::coarse) {
+			insert_coarse(new_node);
+		} else {
+			insert_fine(new_node);
+		}
+		exit(s);
+		sample(s, true);
+	}
+
+	void remove(T v) {
+		slot& s = slots[thread_index()];
+		mode_kind m = enter(s);
+		if(m == mode_kind::coarse) {
+			remove_coarse(v);
+		} else {
+			remove_fine(v);
+		}
+		exit(s);
+		sample(s, true);
+	}
+
+	/* count elements with value v in the list */
+	std::size_t count(T v) {
+		std::size_t cnt;
+		slot& s = slots[thread_index()];
+		mode_kind m = enter(s);
+		if(m == mode_kind::coarse) {
+			coarse_lock.lock();
+			cnt = count_from(head.next.load(), v);
+			coarse_lock.unlock();
+		} else {
+			epoch_guard guard(epoch);
+			cnt = count_from(head.next.load(), v);
+		}
+		exit(s);
+		sample(s, false);
+		return cnt;
+	}
+
+	/* call fn on every element with lo <= value < hi, in order: under the
+	 * coarse lock, or with no operation in flight in fine mode
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		auto walk = [&] {
+			node* curr = head.next.load();
+			while(curr != nullptr && curr->value < lo) {
+				curr = curr->next.load();
+			}
+			while(curr != nullptr && curr->value < hi) {
+				fn(curr->value);
+				curr = curr->next.load();
+			}
+		};
+		slot& s = slots[thread_index()];
+		if(enter(s) == mode_kind::coarse) {
+			coarse_lock.lock();
+			walk();
+			coarse_lock.unlock();
+			exit(s);
+		} else {
+			exit(s);
+			exclusive(walk);
+		}
+	}
+
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> out;
+		for_each_in_range(lo, hi, [&out](const T& v) { out.push_back(v); });
+		return out;
+	}
+};
+
+#endif // lacpp_adaptive_list_hpp
@@ -3,9 +3,35 @@
 #include <random>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "benchmark.hpp"
-#include "sorted_list.hpp"
+#include "lock_stats.hpp"
+
+/* list variant under test, e.g. -DSORTED_LIST_HEADER='"sl_par_6.hpp"' */
+#ifndef SORTED_LIST_HEADER
+#define SORTED_LIST_HEADER "sorted_list.hpp"
+#endif
+#ifndef SORTED_LIST_NAME
+#define SORTED_LIST_NAME "non-thread-safe"
+#endif
+/* e.g. -DSORTED_LIST_TYPE='sorted_list<int, pool_allocator>' */
+#ifndef SORTED_LIST_TYPE
+#define SORTED_LIST_TYPE sorted_list<int>
+#endif
+/* constructor arguments before the prefill range, with a trailing comma,
+ * e.g. -DSORTED_LIST_ARGS='DATA_VALUE_RANGE_MIN, DATA_VALUE_RANGE_MAX,'
+ */
+#ifndef SORTED_LIST_ARGS
+#define SORTED_LIST_ARGS
+#endif
+#include SORTED_LIST_HEADER
+/* -DSORTED_VECTOR_BASELINE also runs sorted_vector_set<int> after the list
+ * under test, for head-to-head numbers from the same binary
+ */
+#ifdef SORTED_VECTOR_BASELINE
+#include "sorted_vector_set.hpp"
+#endif
 
 static const int DATA_VALUE_RANGE_MIN = 0;
 static const int DATA_VALUE_RANGE_MAX = 256;
@@ -41,6 +67,104 @@ void mixed(List& l, int random) {
 	}
 }
 
+/* DATA_PREFILL random values for the bulk constructor */
+std::vector<int> prefill(std::mt19937& engine) {
+	std::uniform_int_distribution<int> uniform_dist(DATA_VALUE_RANGE_MIN, DATA_VALUE_RANGE_MAX);
+	std::vector<int> values(DATA_PREFILL);
+	for(auto& v : values) {
+		v = uniform_dist(engine);
+	}
+	return values;
+}
+
+#ifdef SORTED_VECTOR_BASELINE
+/* sorted_vector_set<int>, skipping the SORTED_LIST_ARGS of the list under test */
+struct sorted_vector_baseline : sorted_vector_set<int> {
+	typedef std::vector<int>::iterator iterator;
+	sorted_vector_baseline(iterator begin, iterator end) : sorted_vector_set<int>(begin, end) {}
+	sorted_vector_baseline(int, int, iterator begin, iterator end) : sorted_vector_set<int>(begin, end) {}
+};
+#endif
+
+template<typename List>
+void run_benchmarks(int threadcnt, const std::string& name, std::mt19937& engine) {
+	{
+		std::vector<int> values = prefill(engine);
+		List l1(SORTED_LIST_ARGS values.begin(), values.end());
+		benchmark(threadcnt, name + u8" read", [&l1](int random){
+			read(l1, random);
+		});
+		benchmark(threadcnt, name + u8" update", [&l1](int random){
+			update(l1, random);
+		});
+	}
+	{
+		/* start with fresh list: update test left list in random size */
+		std::vector<int> values = prefill(engine);
+		List l1(SORTED_LIST_ARGS values.begin(), values.end());
+		benchmark(threadcnt, name + u8" mixed", [&l1](int random){
+			mixed(l1, random);
+		});
+	}
+}
+
+#ifdef lacpp_sl_policy_hpp
+/* Anderson lock slots: bounds the benchmark threads, since each thread
+ * waits for at most one lock at a time. The default of MAX_THREADS slots
+ * would make every list node 16 KB.
+ */
+static const std::size_t ANDERSON_SLOTS = 64;
+
+/* lock site for the contention report: one per lock and granularity */
+template<typename Lock, typename Granularity>
+struct policy_site {};
+
+/* Lock, instrumented when built with -DLACPP_LOCK_STATS */
+template<typename Lock, typename Granularity>
+using policy_lock = lacpp::instrumented_lock<Lock, policy_site<Lock, Granularity>>;
+
+/* lacpp::sorted_list combinations, selected by name: <lock> <granularity> */
+template<typename Lock>
+bool run_policy(int threadcnt, const std::string& lock, const std::string& granularity, std::mt19937& engine) {
+	std::string name = lock + u8"/" + granularity;
+	if(granularity == u8"coarse") {
+		run_benchmarks<lacpp::sorted_list<int, policy_lock<Lock, lacpp::coarse>, lacpp::coarse>>(threadcnt, name, engine);
+	} else if(granularity == u8"hoh") {
+		run_benchmarks<lacpp::sorted_list<int, policy_lock<Lock, lacpp::hand_over_hand>, lacpp::hand_over_hand>>(threadcnt, name, engine);
+	} else if(granularity == u8"optimistic") {
+		run_benchmarks<lacpp::sorted_list<int, policy_lock<Lock, lacpp::optimistic>, lacpp::optimistic>>(threadcnt, name, engine);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+bool run_policy(int threadcnt, const std::string& lock, const std::string& granularity, std::mt19937& engine) {
+	if(lock == u8"mutex") {
+		return run_policy<std::mutex>(threadcnt, lock, granularity, engine);
+	} else if(lock == u8"tatas") {
+		return run_policy<lacpp::tatas_lock>(threadcnt, lock, granularity, engine);
+	} else if(lock == u8"futex") {
+		return run_policy<lacpp::futex_lock>(threadcnt, lock, granularity, engine);
+	} else if(lock == u8"ticket") {
+		return run_policy<lacpp::ticket_lock>(threadcnt, lock, granularity, engine);
+	} else if(lock == u8"anderson") {
+		if(threadcnt > static_cast<int>(ANDERSON_SLOTS)) {
+			std::cerr << u8"Skipping anderson: at most " << ANDERSON_SLOTS << u8" threads\n";
+			return true;
+		}
+		return run_policy<lacpp::anderson_lock<ANDERSON_SLOTS>>(threadcnt, lock, granularity, engine);
+	} else if(lock == u8"cohort") {
+		return run_policy<lacpp::cohort_lock>(threadcnt, lock, granularity, engine);
+	} else if(lock == u8"mcs") {
+		return run_policy<lacpp::mcs_mutex>(threadcnt, lock, granularity, engine);
+	} else if(lock == u8"clh") {
+		return run_policy<lacpp::clh_mutex>(threadcnt, lock, granularity, engine);
+	}
+	return false;
+}
+#endif
+
 int main(int argc, char* argv[]) {
 	/* get number of threads from command line */
 	if(argc < 2) {
@@ -56,32 +180,29 @@ int main(int argc, char* argv[]) {
 	/* set up random number generator */
 	std::random_device rd;
 	std::mt19937 engine(rd());
-	std::uniform_int_distribution<int> uniform_dist(DATA_VALUE_RANGE_MIN, DATA_VALUE_RANGE_MAX);
 
-	/* example use of benchmarking */
-	{
-		sorted_list<int> l1;
-		/* prefill list with 1024 elements */
-		for(int i = 0; i < DATA_PREFILL; i++) {
-			l1.insert(uniform_dist(engine));
+#ifdef lacpp_sl_policy_hpp
+	/* policy-based lists: <threads> [<lock> <granularity>], all combinations by default */
+	if(argc >= 4) {
+		if(!run_policy(threadcnt, argv[2], argv[3], engine)) {
+			std::cerr << u8"Unknown combination '" << argv[2] << u8" " << argv[3] << u8"'\n";
+			std::exit(EXIT_FAILURE);
 		}
-		benchmark(threadcnt, u8"non-thread-safe read", [&l1](int random){
-			read(l1, random);
-		});
-		benchmark(threadcnt, u8"non-thread-safe update", [&l1](int random){
-			update(l1, random);
-		});
+		lacpp::print_lock_report(std::cout);
+		return EXIT_SUCCESS;
 	}
-	{
-		/* start with fresh list: update test left list in random size */
-		sorted_list<int> l1;
-		/* prefill list with 1024 elements */
-		for(int i = 0; i < DATA_PREFILL; i++) {
-			l1.insert(uniform_dist(engine));
+	for(auto lock : {u8"mutex", u8"tatas", u8"futex", u8"ticket", u8"anderson", u8"cohort", u8"mcs", u8"clh"}) {
+		for(auto granularity : {u8"coarse", u8"hoh", u8"optimistic"}) {
+			run_policy(threadcnt, lock, granularity, engine);
 		}
-		benchmark(threadcnt, u8"non-thread-safe mixed", [&l1](int random){
-			mixed(l1, random);
-		});
 	}
+#else
+	run_benchmarks<SORTED_LIST_TYPE>(threadcnt, u8"" SORTED_LIST_NAME, engine);
+#endif
+#ifdef SORTED_VECTOR_BASELINE
+	run_benchmarks<sorted_vector_baseline>(threadcnt, u8"sorted_vector_set", engine);
+#endif
+	/* with -DLACPP_LOCK_STATS: acquisitions, contention, wait and hold times */
+	lacpp::print_lock_report(std::cout);
 	return EXIT_SUCCESS;
 }
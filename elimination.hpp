@@ -0,0 +1,159 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "locks.hpp"
+#include "thread_index.hpp"
+/* list variant to wrap by default, e.g. -DELIMINATION_LIST_HEADER='"sl_par_6.hpp"' */
+#ifndef ELIMINATION_LIST_HEADER
+#define ELIMINATION_LIST_HEADER "sl_par_7.hpp"
+#endif
+#include ELIMINATION_LIST_HEADER
+#ifndef lacpp_elimination_hpp
+#define lacpp_elimination_hpp lacpp_elimination_hpp
+
+/* elimination layer in front of a concurrent list (after the elimination
+ * backoff stack of Hendler, Shavit and Yerushalmi, 2004)
+ *
+ * An insert(v) and a remove(v) that overlap in time can be linearized
+ * back to back, insert first, which leaves the list as it was. So before
+ * touching the list, an update looks into the slot its key hashes to: if
+ * the opposite update of the same key is waiting there, it claims it and
+ * both return at once. Otherwise it parks its own offer in the empty slot
+ * for a short window, withdraws it if nobody came, and goes to the list.
+ *
+ * The window adapts per thread: it doubles after an elimination and halves
+ * after a timeout, so uncontended threads pay a few atomics per update and
+ * no waiting. count() and the range queries go straight to the list.
+ */
+template<typename T, typename List = sorted_list<T>, std::size_t Slots = 32>
+class elimination_list {
+	static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+	static const unsigned MIN_WINDOW = 1;
+	static const unsigned MAX_WINDOW = 1024;
+
+	enum class op_kind {insert, remove};
+
+	/* offer state: (incarnation << 2) | status */
+	static const std::uint64_t IDLE = 0;
+	static const std::uint64_t WAITING = 1;
+	static const std::uint64_t MATCHED = 2;
+	static const std::uint64_t STATUS = 3;
+
+	/* per-thread offer, reused by every update of its owner */
+	struct alignas(CACHELINE_SIZE) offer {
+		std::atomic<std::uint64_t>	state{IDLE};
+		std::atomic<op_kind>		op{op_kind::insert};
+		std::atomic<T>				value{T()};
+		/* owner only */
+		unsigned					window = MIN_WINDOW;
+	};
+
+	struct alignas(CACHELINE_SIZE) slot {
+		std::atomic<offer*>	waiting{nullptr};
+	};
+
+	List	list;
+	slot	slots[Slots];
+	offer	offers[MAX_THREADS];
+
+	/* claim a waiting offer of the opposite update on v, if s holds one */
+	static bool take(slot& s, offer& mine, op_kind op, T v) {
+		offer* other = s.waiting.load(std::memory_order_acquire);
+		if(other == nullptr || other == &mine) {
+			return false;
+		}
+		std::uint64_t st = other->state.load(std::memory_order_acquire);
+		if((st & STATUS) != WAITING || other->op.load(std::memory_order_relaxed) == op
+				|| other->value.load(std::memory_order_relaxed) != v) {
+			return false;
+		}
+		/* fails if the owner withdrew, or moved on to another update */
+		return other->state.compare_exchange_strong(st, (st & ~STATUS) | MATCHED, std::memory_order_acq_rel);
+	}
+
+	/* true if the update was cancelled out by the opposite one */
+	bool eliminate(op_kind op, T v) {
+		slot& s = slots[std::hash<T>()(v) & (Slots - 1)];
+		offer& mine = offers[thread_index()];
+		if(take(s, mine, op, v)) {
+			return true;
+		}
+
+		/* publish a fresh incarnation; the previous one ended matched or withdrawn */
+		mine.op.store(op, std::memory_order_relaxed);
+		mine.value.store(v, std::memory_order_relaxed);
+		std::uint64_t st = ((mine.state.load(std::memory_order_relaxed) >> 2) + 1) << 2 | WAITING;
+		mine.state.store(st, std::memory_order_release);
+		offer* expected = nullptr;
+		if(!s.waiting.compare_exchange_strong(expected, &mine, std::memory_order_acq_rel)) {
+			/* slot busy with another key: do not wait. A thread still holding
+			 * our address from an earlier update may have matched us anyway.
+			 */
+			return !mine.state.compare_exchange_strong(st, (st & ~STATUS) | IDLE, std::memory_order_acq_rel);
+		}
+
+		for(unsigned i = 0; i < mine.window && mine.state.load(std::memory_order_acquire) == st; i++) {
+			lacpp::cpu_relax();
+		}
+		bool matched = !mine.state.compare_exchange_strong(st, (st & ~STATUS) | IDLE, std::memory_order_acq_rel);
+		s.waiting.store(nullptr, std::memory_order_release);
+
+		if(matched) {
+			mine.window = mine.window < MAX_WINDOW ? mine.window * 2 : MAX_WINDOW;
+		} else {
+			mine.window = mine.window > MIN_WINDOW ? mine.window / 2 : MIN_WINDOW;
+		}
+		return matched;
+	}
+
+public:
+	elimination_list() = default;
+	/* build from the values in [begin, end), sorted or not */
+	template<typename InputIt>
+	elimination_list(InputIt begin, InputIt end) : list(begin, end) {}
+	elimination_list(const elimination_list&) = delete;
+	elimination_list& operator=(const elimination_list&) = delete;
+
+	/* remove all elements */
+	void clear() { list.clear(); }
+
+	/* insert v into the list */
+	void insert(T v) {
+		if(!eliminate(op_kind::insert, v)) {
+			list.insert(v);
+		}
+	}
+
+	void remove(T v) {
+		if(!eliminate(op_kind::remove, v)) {
+			list.remove(v);
+		}
+	}
+
+	/* count elements with value v in the list */
+	std::size_t count(T v) { return list.count(v); }
+
+	/* range queries, only declared if List has them (all variants but the
+	 * lock-free sl_par_6 and the skip list sl_par_10 do)
+	 */
+	template<typename F, typename L = List>
+	auto for_each_in_range(T lo, T hi, F fn) -> decltype(std::declval<L&>().for_each_in_range(lo, hi, fn)) {
+		list.for_each_in_range(lo, hi, fn);
+	}
+
+	template<typename L = List>
+	auto count_range(T lo, T hi) -> decltype(std::declval<L&>().count_range(lo, hi)) {
+		return list.count_range(lo, hi);
+	}
+
+	template<typename L = List>
+	auto snapshot_range(T lo, T hi) -> decltype(std::declval<L&>().snapshot_range(lo, hi)) {
+		return list.snapshot_range(lo, hi);
+	}
+};
+
+#endif // lacpp_elimination_hpp
@@ -0,0 +1,128 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "thread_index.hpp"
+#ifndef lacpp_epoch_hpp
+#define lacpp_epoch_hpp lacpp_epoch_hpp
+
+/* epoch-based memory reclamation (Fraser, 2004)
+ *
+ * Threads announce the global epoch while inside a critical section.
+ * Unlinked objects are retired into a bucket tagged with the epoch current
+ * at retire time; the global epoch only advances once every active thread
+ * has announced it, so a bucket is safe to free two epochs later.
+ */
+class epoch_domain {
+	struct retired {
+		void*	ptr;
+		void	(*deleter)(void*);
+	};
+
+	struct bucket {
+		std::uint64_t			epoch = 0;
+		std::vector<retired>	items;
+	};
+
+	struct alignas(CACHELINE_SIZE) record {
+		/* (announced epoch << 1) | active */
+		std::atomic<std::uint64_t>	state{0};
+		std::size_t					retire_count = 0;
+		bucket						buckets[3];
+	};
+
+	static const std::size_t ADVANCE_INTERVAL = 64;
+
+	alignas(CACHELINE_SIZE) std::atomic<std::uint64_t> global{0};
+	record records[MAX_THREADS];
+
+	template<typename N>
+	static void delete_node(void* p) { delete static_cast<N*>(p); }
+
+	template<typename Alloc, typename N>
+	static void deallocate_node(void* p) { Alloc::deallocate(static_cast<N*>(p)); }
+
+	static void release(bucket& b) {
+		for(auto& r : b.items) {
+			r.deleter(r.ptr);
+		}
+		b.items.clear();
+	}
+
+	void try_advance() {
+		std::uint64_t epoch = global.load();
+		std::size_t high = thread_index_registry::instance().high_water();
+		for(std::size_t i = 0; i < high; i++) {
+			std::uint64_t s = records[i].state.load();
+			if((s & 1) && (s >> 1) != epoch) {
+				/* someone is still in an older epoch */
+				return;
+			}
+		}
+		global.compare_exchange_strong(epoch, epoch + 1);
+	}
+
+public:
+	epoch_domain() = default;
+	epoch_domain(const epoch_domain&) = delete;
+	epoch_domain& operator=(const epoch_domain&) = delete;
+	~epoch_domain() {
+		for(auto& r : records) {
+			for(auto& b : r.buckets) {
+				release(b);
+			}
+		}
+	}
+
+	void enter() {
+		record& r = records[thread_index()];
+		/* seq_cst store: ordered before every load of the traversal that follows */
+		r.state.store((global.load() << 1) | 1);
+	}
+
+	/* epoch the caller announced; only meaningful inside enter()/exit() */
+	std::uint64_t announced() const {
+		return records[thread_index()].state.load(std::memory_order_relaxed) >> 1;
+	}
+
+	void exit() {
+		record& r = records[thread_index()];
+		r.state.store(r.state.load(std::memory_order_relaxed) & ~std::uint64_t(1), std::memory_order_release);
+	}
+
+	/* hand an unlinked node over for deferred deletion; caller must be inside enter()/exit() */
+	template<typename N>
+	void retire(N* p) { retire(p, &delete_node<N>); }
+
+	/* same, for nodes obtained from a node allocator (see node_pool.hpp) */
+	template<typename Alloc, typename N>
+	void retire_to(N* p) { retire(p, &deallocate_node<Alloc, N>); }
+
+	void retire(void* p, void (*deleter)(void*)) {
+		record& r = records[thread_index()];
+		std::uint64_t epoch = global.load();
+		bucket& b = r.buckets[epoch % 3];
+		if(b.epoch != epoch) {
+			/* bucket was filled at epoch - 3 or earlier: nobody can still see it */
+			release(b);
+			b.epoch = epoch;
+		}
+		b.items.push_back(retired{p, deleter});
+		if(++r.retire_count % ADVANCE_INTERVAL == 0) {
+			try_advance();
+		}
+	}
+};
+
+/* scoped critical section */
+class epoch_guard {
+	epoch_domain& domain;
+
+public:
+	explicit epoch_guard(epoch_domain& d) : domain(d) { domain.enter(); }
+	~epoch_guard() { domain.exit(); }
+	epoch_guard(const epoch_guard&) = delete;
+	epoch_guard& operator=(const epoch_guard&) = delete;
+};
+
+#endif // lacpp_epoch_hpp
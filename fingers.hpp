@@ -0,0 +1,83 @@
+#include <cstddef>
+#include <cstdint>
+#include "epoch.hpp"
+#include "thread_index.hpp"
+#ifndef lacpp_fingers_hpp
+#define lacpp_fingers_hpp lacpp_fingers_hpp
+
+/* per-thread search fingers for lists reclaimed through an epoch_domain
+ *
+ * Each thread remembers the last N nodes it ended a search at, so a thread
+ * whose keys are close to each other can start the next search there
+ * instead of at the head. A finger is stamped with the epoch announced
+ * when it was taken. Every node reachable at that time is retired in that
+ * epoch or later and thus freed no earlier than three epochs on, while an
+ * active thread holds the global epoch to at most one past its own
+ * announcement: a finger whose stamp is at most one behind the caller's
+ * announcement still points to allocated memory. Whether the node is still
+ * linked and where it sits is up to the list to check (e.g. a mark).
+ *
+ * With N = 0 the cache is empty and every search starts at the head.
+ */
+template<typename Node, std::size_t N>
+class finger_cache {
+	struct alignas(CACHELINE_SIZE) fingers {
+		Node*			nodes[N] = {};
+		std::uint64_t	stamps[N] = {};
+		std::size_t		victim = 0;
+	};
+
+	fingers per_thread[MAX_THREADS];
+
+public:
+	/* best safe finger according to usable(node) and closer(a, b), or
+	 * nullptr; slot receives its index for remember(). Caller must be inside
+	 * an epoch_guard of domain.
+	 */
+	template<typename Usable, typename Closer>
+	Node* find(const epoch_domain& domain, Usable usable, Closer closer, int& slot) {
+		fingers& f = per_thread[thread_index()];
+		std::uint64_t now = domain.announced();
+		Node* best = nullptr;
+		slot = -1;
+		for(std::size_t i = 0; i < N; i++) {
+			Node* n = f.nodes[i];
+			if(n == nullptr || f.stamps[i] + 1 < now || !usable(n)) {
+				continue;
+			}
+			if(best == nullptr || closer(n, best)) {
+				best = n;
+				slot = static_cast<int>(i);
+			}
+		}
+		return best;
+	}
+
+	/* remember n, replacing the finger in slot (from find()) or the oldest one */
+	void remember(const epoch_domain& domain, Node* n, int slot) {
+		fingers& f = per_thread[thread_index()];
+		std::size_t i;
+		if(slot >= 0) {
+			i = static_cast<std::size_t>(slot);
+		} else {
+			i = f.victim;
+			f.victim = (f.victim + 1) % N;
+		}
+		f.nodes[i] = n;
+		f.stamps[i] = domain.announced();
+	}
+};
+
+template<typename Node>
+class finger_cache<Node, 0> {
+public:
+	template<typename Usable, typename Closer>
+	Node* find(const epoch_domain&, Usable, Closer, int& slot) {
+		slot = -1;
+		return nullptr;
+	}
+
+	void remember(const epoch_domain&, Node*, int) {}
+};
+
+#endif // lacpp_fingers_hpp
@@ -0,0 +1,118 @@
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "sorted_list.hpp"
+#include "thread_index.hpp"
+#ifndef lacpp_flat_combining_hpp
+#define lacpp_flat_combining_hpp lacpp_flat_combining_hpp
+
+/* flat combining (Hendler, Incze, Shavit and Tzafrir, 2010) around a
+ * sequential list with the batch interface of sorted_list.hpp
+ *
+ * A thread publishes its operation in its own padded slot and then tries
+ * the combiner lock. Whoever gets it collects every pending request,
+ * applies them with count_many/insert_many/remove_many (one sorted pass
+ * each) and hands the results back through the slots. The list itself
+ * stays in the combiner's cache and the lock changes hands once per batch
+ * rather than once per operation.
+ */
+template<typename T, typename List = sorted_list<T>>
+class flat_combining_list {
+	enum class op_kind {insert, remove, count};
+	enum class slot_state {empty, pending, done};
+
+	struct alignas(CACHELINE_SIZE) request {
+		std::atomic<slot_state>	state{slot_state::empty};
+		op_kind					op;
+		T						value;
+		std::size_t				result;
+	};
+
+	List		list;
+	std::mutex	combiner;
+	request		slots[MAX_THREADS];
+
+	/* combiner-only scratch space, kept to avoid allocating per batch */
+	std::vector<request*>		requests[3];
+	std::vector<T>				values[3];
+	std::vector<std::size_t>	results;
+
+	void combine() {
+		for(int k = 0; k < 3; k++) {
+			requests[k].clear();
+			values[k].clear();
+		}
+		std::size_t high = thread_index_registry::instance().high_water();
+		for(std::size_t i = 0; i < high; i++) {
+			request& r = slots[i];
+			if(r.state.load(std::memory_order_acquire) != slot_state::pending) {
+				continue;
+			}
+			int k = static_cast<int>(r.op);
+			requests[k].push_back(&r);
+			values[k].push_back(r.value);
+		}
+
+		/* all collected requests are concurrent, so any order is linearizable */
+		const int c = static_cast<int>(op_kind::count);
+		const int i = static_cast<int>(op_kind::insert);
+		const int d = static_cast<int>(op_kind::remove);
+		results.resize(values[c].size());
+		list.count_many(values[c].data(), values[c].size(), results.data());
+		list.insert_many(values[i].data(), values[i].size());
+		list.remove_many(values[d].data(), values[d].size());
+
+		for(std::size_t j = 0; j < results.size(); j++) {
+			requests[c][j]->result = results[j];
+		}
+		for(auto& batch : requests) {
+			for(auto r : batch) {
+				r->state.store(slot_state::done, std::memory_order_release);
+			}
+		}
+	}
+
+	std::size_t execute(op_kind op, T v) {
+		request& r = slots[thread_index()];
+		r.op = op;
+		r.value = v;
+		r.state.store(slot_state::pending, std::memory_order_release);
+		while(r.state.load(std::memory_order_acquire) != slot_state::done) {
+			if(combiner.try_lock()) {
+				combine();
+				combiner.unlock();
+			} else {
+				std::this_thread::yield();
+			}
+		}
+		std::size_t result = r.result;
+		r.state.store(slot_state::empty, std::memory_order_relaxed);
+		return result;
+	}
+
+public:
+	flat_combining_list() = default;
+	/* build from the values in [begin, end), sorted or not */
+	template<typename InputIt>
+	flat_combining_list(InputIt begin, InputIt end) : list(begin, end) {}
+	flat_combining_list(const flat_combining_list&) = delete;
+	flat_combining_list& operator=(const flat_combining_list&) = delete;
+
+	/* remove all elements; holding the combiner lock keeps batches out */
+	void clear() {
+		std::lock_guard<std::mutex> lock(combiner);
+		list.clear();
+	}
+
+	/* insert v into the list */
+	void insert(T v) { execute(op_kind::insert, v); }
+
+	void remove(T v) { execute(op_kind::remove, v); }
+
+	/* count elements with value v in the list */
+	std::size_t count(T v) { return execute(op_kind::count, v); }
+};
+
+#endif // lacpp_flat_combining_hpp
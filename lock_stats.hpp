@@ -0,0 +1,302 @@
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#ifdef LACPP_LOCK_STATS
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+#include <cxxabi.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "thread_index.hpp"
+#endif
+#ifndef lacpp_lock_stats_hpp
+#define lacpp_lock_stats_hpp lacpp_lock_stats_hpp
+
+/* lock contention instrumentation
+ *
+ * lacpp::instrumented_lock<Lock, Site> wraps any BasicLockable Lock. For
+ * every Site (a tag type; all locks sharing it are counted together) it
+ * records acquisitions, contended acquisitions, and log2-bucketed
+ * histograms of wait time (lock() entry to acquisition) and hold time
+ * (acquisition to unlock()), in rdtsc cycles on x86 and steady_clock
+ * nanoseconds elsewhere. Counters are per thread and per site, written
+ * only by their owner, and merged by print_lock_report().
+ *
+ * An acquisition counts as contended if Lock::try_lock() fails, or, for
+ * locks without try_lock(), if it waited at least CONTENDED_WAIT ticks.
+ *
+ * Statistics are compiled in with -DLACPP_LOCK_STATS only. Otherwise
+ * instrumented_lock<Lock, Site> is an alias for Lock and the report
+ * functions do nothing, so instrumented code is the same as plain code.
+ */
+
+namespace lacpp {
+
+#ifdef LACPP_LOCK_STATS
+
+/* timestamps for wait and hold times */
+struct lock_clock {
+#if defined(__x86_64__) || defined(__i386__)
+	static const char* unit() { return "cycles"; }
+	static std::uint64_t now() { return __rdtsc(); }
+#else
+	static const char* unit() { return "ns"; }
+	static std::uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+#endif
+};
+
+/* one lock site: per-thread counters and their merged report */
+class lock_site {
+public:
+	static const std::size_t BUCKETS = 40;
+
+private:
+	/* only the owning thread writes, so plain relaxed load/store suffices */
+	struct alignas(CACHELINE_SIZE) counters {
+		std::atomic<std::uint64_t>	acquisitions{0};
+		std::atomic<std::uint64_t>	contended{0};
+		std::atomic<std::uint64_t>	wait_total{0};
+		std::atomic<std::uint64_t>	hold_total{0};
+		std::atomic<std::uint64_t>	wait[BUCKETS];
+		std::atomic<std::uint64_t>	hold[BUCKETS];
+
+		counters() {
+			for(std::size_t b = 0; b < BUCKETS; b++) {
+				wait[b].store(0, std::memory_order_relaxed);
+				hold[b].store(0, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	std::string	site_name;
+	counters	per_thread[MAX_THREADS];
+
+	static void bump(std::atomic<std::uint64_t>& c, std::uint64_t by = 1) {
+		c.store(c.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+	}
+
+	/* bucket b holds times below 2^b and, for b > 0, at least 2^(b-1) */
+	static std::size_t bucket(std::uint64_t ticks) {
+		std::size_t b = ticks == 0 ? 0 : 64 - __builtin_clzll(ticks);
+		return b < BUCKETS ? b : BUCKETS - 1;
+	}
+
+	static void print_histogram(std::ostream& out, const char* what, const std::vector<std::uint64_t>& h) {
+		std::uint64_t total = 0;
+		for(auto n : h) {
+			total += n;
+		}
+		if(total == 0) {
+			return;
+		}
+		out << "    " << what << " (" << lock_clock::unit() << "):\n";
+		for(std::size_t b = 0; b < h.size(); b++) {
+			if(h[b] == 0) {
+				continue;
+			}
+			out << "      < " << std::setw(12) << (std::uint64_t(1) << b) << " " << std::setw(12) << h[b]
+				<< " " << std::setw(6) << std::fixed << std::setprecision(2) << 100.0 * h[b] / total << "%\n";
+		}
+	}
+
+public:
+	explicit lock_site(std::string name);
+
+	void record(bool contended, std::uint64_t wait) {
+		counters& c = per_thread[thread_index()];
+		bump(c.acquisitions);
+		if(contended) {
+			bump(c.contended);
+		}
+		bump(c.wait_total, wait);
+		bump(c.wait[bucket(wait)]);
+	}
+
+	void record_hold(std::uint64_t hold) {
+		counters& c = per_thread[thread_index()];
+		bump(c.hold_total, hold);
+		bump(c.hold[bucket(hold)]);
+	}
+
+	/* merge the per-thread counters; call with no lock operation running */
+	void report(std::ostream& out) const {
+		std::uint64_t acquisitions = 0, contended = 0, wait_total = 0, hold_total = 0;
+		std::vector<std::uint64_t> wait(BUCKETS), hold(BUCKETS);
+		std::size_t high = thread_index_registry::instance().high_water();
+		for(std::size_t i = 0; i < high; i++) {
+			const counters& c = per_thread[i];
+			acquisitions += c.acquisitions.load(std::memory_order_relaxed);
+			contended += c.contended.load(std::memory_order_relaxed);
+			wait_total += c.wait_total.load(std::memory_order_relaxed);
+			hold_total += c.hold_total.load(std::memory_order_relaxed);
+			for(std::size_t b = 0; b < BUCKETS; b++) {
+				wait[b] += c.wait[b].load(std::memory_order_relaxed);
+				hold[b] += c.hold[b].load(std::memory_order_relaxed);
+			}
+		}
+		if(acquisitions == 0) {
+			return;
+		}
+		out << "  " << site_name << ": " << acquisitions << " acquisitions, " << contended << " contended ("
+			<< std::fixed << std::setprecision(2) << 100.0 * contended / acquisitions << "%), mean wait "
+			<< wait_total / acquisitions << ", mean hold " << hold_total / acquisitions << " " << lock_clock::unit() << "\n";
+		print_histogram(out, "wait", wait);
+		print_histogram(out, "hold", hold);
+	}
+
+	void reset() {
+		for(auto& c : per_thread) {
+			c.acquisitions.store(0, std::memory_order_relaxed);
+			c.contended.store(0, std::memory_order_relaxed);
+			c.wait_total.store(0, std::memory_order_relaxed);
+			c.hold_total.store(0, std::memory_order_relaxed);
+			for(std::size_t b = 0; b < BUCKETS; b++) {
+				c.wait[b].store(0, std::memory_order_relaxed);
+				c.hold[b].store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+};
+
+/* every site that has been used, in order of first use */
+class lock_site_registry {
+	std::mutex				mutex;
+	std::vector<lock_site*>	sites;
+
+public:
+	static lock_site_registry& instance() {
+		static lock_site_registry registry;
+		return registry;
+	}
+
+	void add(lock_site* site) {
+		std::lock_guard<std::mutex> lock(mutex);
+		sites.push_back(site);
+	}
+
+	template<typename F>
+	void for_each(F fn) {
+		std::lock_guard<std::mutex> lock(mutex);
+		for(auto site : sites) {
+			fn(*site);
+		}
+	}
+};
+
+inline lock_site::lock_site(std::string name) : site_name(std::move(name)) {
+	lock_site_registry::instance().add(this);
+}
+
+/* demangled name of type T */
+template<typename T>
+std::string type_name() {
+	int status = 0;
+	char* name = abi::__cxa_demangle(typeid(T).name(), nullptr, nullptr, &status);
+	std::string result(status == 0 ? name : typeid(T).name());
+	std::free(name);
+	return result;
+}
+
+/* the lock_site for tag type Site, named after it */
+template<typename Site>
+lock_site& site_of() {
+	/* a static rather than a heap object: counters are cache line aligned */
+	static lock_site site(type_name<Site>());
+	return site;
+}
+
+/* true if L has a try_lock() member */
+template<typename L>
+class has_try_lock {
+	template<typename U>
+	static auto test(int) -> decltype(std::declval<U&>().try_lock(), std::true_type());
+	template<typename U>
+	static std::false_type test(...);
+
+public:
+	static const bool value = decltype(test<L>(0))::value;
+};
+
+template<typename Lock, typename Site = Lock>
+class instrumented_lock {
+	/* waits at least this long count as contended for locks without try_lock() */
+	static const std::uint64_t CONTENDED_WAIT = 1024;
+
+	Lock			inner;
+	/* written by the holder only */
+	std::uint64_t	acquired = 0;
+
+	template<typename L = Lock>
+	typename std::enable_if<has_try_lock<L>::value, bool>::type acquire() {
+		if(inner.try_lock()) {
+			return false;
+		}
+		inner.lock();
+		return true;
+	}
+
+	template<typename L = Lock>
+	typename std::enable_if<!has_try_lock<L>::value, bool>::type acquire() {
+		inner.lock();
+		return false;
+	}
+
+public:
+	instrumented_lock() = default;
+	instrumented_lock(const instrumented_lock&) = delete;
+	instrumented_lock& operator=(const instrumented_lock&) = delete;
+
+	void lock() {
+		std::uint64_t start = lock_clock::now();
+		bool contended = acquire();
+		acquired = lock_clock::now();
+		std::uint64_t wait = acquired - start;
+		if(!has_try_lock<Lock>::value && wait >= CONTENDED_WAIT) {
+			contended = true;
+		}
+		site_of<Site>().record(contended, wait);
+	}
+
+	void unlock() {
+		std::uint64_t hold = lock_clock::now() - acquired;
+		inner.unlock();
+		site_of<Site>().record_hold(hold);
+	}
+};
+
+/* contention report over every site used so far */
+inline void print_lock_report(std::ostream& out) {
+	out << "lock contention report:\n";
+	lock_site_registry::instance().for_each([&out](const lock_site& site) { site.report(out); });
+}
+
+inline void reset_lock_stats() {
+	lock_site_registry::instance().for_each([](lock_site& site) { site.reset(); });
+}
+
+#else
+
+template<typename Lock, typename Site = Lock>
+using instrumented_lock = Lock;
+
+inline void print_lock_report(std::ostream&) {}
+
+inline void reset_lock_stats() {}
+
+#endif
+
+} // namespace lacpp
+
+#endif // lacpp_lock_stats_hpp
@@ -0,0 +1,508 @@
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "node_pool.hpp"
+#include "numa.hpp"
+#ifndef lacpp_locks_hpp
+#define lacpp_locks_hpp lacpp_locks_hpp
+
+/* lock policies for lacpp::sorted_list (sl_policy.hpp)
+ *
+ * Every lock here is BasicLockable (lock()/unlock()), so std::mutex and
+ * std::lock_guard/std::unique_lock work with them unchanged.
+ */
+
+#ifndef CACHELINE_SIZE
+#define CACHELINE_SIZE 64
+#endif
+
+namespace lacpp {
+
+/* test-and-test-and-set spin lock, as in sl_par_3.hpp */
+struct tatas_lock {
+	std::atomic_bool state{false};
+
+public:
+	void lock() {
+		while (true) {
+			while (state.load(std::memory_order_relaxed))
+			{
+				std::this_thread::yield();
+			}
+			if (!state.exchange(true, std::memory_order_acquire))
+			{
+				return;
+			}
+		}
+	}
+
+	bool try_lock() {
+		return !state.load(std::memory_order_relaxed) && !state.exchange(true, std::memory_order_acquire);
+	}
+
+	void unlock() { state.store(false, std::memory_order_release); }
+};
+
+/* spin-wait hint: lets the sibling hyperthread run and saves power */
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield" ::: "memory");
+#endif
+}
+
+/* pause for the FIFO spin locks: spin for a bounded number of pauses in
+ * total, then assume the thread we wait for is not running (more threads
+ * than cores) and give up the CPU between polls; a strict handoff order
+ * otherwise stalls for a whole time slice per handoff
+ */
+inline void spin_then_yield(unsigned& spins, unsigned pauses = 1) {
+	static const unsigned SPIN_LIMIT = 1u << 12;
+	if (spins < SPIN_LIMIT) {
+		for (unsigned i = 0; i < pauses; i++) {
+			cpu_relax();
+		}
+		spins += pauses;
+	} else {
+		std::this_thread::yield();
+	}
+}
+
+/* one-byte test-and-test-and-set lock, small enough to sit in the padding
+ * next to a node's value (see sl_par_13.hpp)
+ */
+class byte_lock {
+	std::atomic<unsigned char> state{0};
+
+public:
+	byte_lock() = default;
+	byte_lock(const byte_lock&) = delete;
+	byte_lock& operator=(const byte_lock&) = delete;
+
+	void lock() {
+		unsigned spins = 0;
+		while (state.exchange(1, std::memory_order_acquire) != 0) {
+			while (state.load(std::memory_order_relaxed) != 0) {
+				spin_then_yield(spins);
+			}
+		}
+	}
+
+	void unlock() { state.store(0, std::memory_order_release); }
+};
+static_assert(sizeof(byte_lock) == 1, "byte_lock must fit in one byte");
+
+/* spin-then-park lock on a Linux futex (Drepper, "Futexes Are Tricky")
+ *
+ * state is 0 (free), 1 (held) or 2 (held, maybe with sleepers). An
+ * acquirer first spins with pause and exponential backoff for a short
+ * while, which is enough when the holder is running; after that it marks
+ * the lock contended and sleeps in the kernel. unlock only enters the
+ * kernel if someone may sleep, and then wakes exactly one waiter. Unlike
+ * tatas_lock nobody yields in a loop, so oversubscribed runs do not keep
+ * the scheduler busy with threads that cannot make progress.
+ */
+class futex_lock {
+	static const int SPIN_LIMIT = 1024;
+	static const int BACKOFF_LIMIT = 64;
+
+	std::atomic<int> state{0};
+
+	int* word() { return reinterpret_cast<int*>(&state); }
+
+	void wait(int expected) {
+		syscall(SYS_futex, word(), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+	}
+
+	void wake_one() {
+		syscall(SYS_futex, word(), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+	}
+
+public:
+	futex_lock() = default;
+	futex_lock(const futex_lock&) = delete;
+	futex_lock& operator=(const futex_lock&) = delete;
+
+	void lock() {
+		int c = 0;
+		if (state.compare_exchange_strong(c, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+			return;
+		}
+		/* spin phase: wait for the holder with growing pauses */
+		int backoff = 1;
+		for (int spins = 0; spins < SPIN_LIMIT; spins += backoff) {
+			for (int i = 0; i < backoff; i++) {
+				cpu_relax();
+			}
+			if (backoff < BACKOFF_LIMIT) {
+				backoff <<= 1;
+			}
+			c = state.load(std::memory_order_relaxed);
+			if (c == 0 && state.compare_exchange_weak(c, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+				return;
+			}
+			if (c == 2) {
+				/* others are already sleeping, do not overtake them by spinning */
+				break;
+			}
+		}
+		/* park phase: whoever takes the lock from here leaves it marked contended */
+		c = state.exchange(2, std::memory_order_acquire);
+		while (c != 0) {
+			wait(2);
+			c = state.exchange(2, std::memory_order_acquire);
+		}
+	}
+
+	void unlock() {
+		if (state.exchange(0, std::memory_order_release) == 2) {
+			wake_one();
+		}
+	}
+};
+
+/* ticket lock with proportional backoff (Mellor-Crummey and Scott, 1991)
+ *
+ * Acquirers draw a ticket and are served in order. A waiter knows how many
+ * holders are ahead of it, so it pauses for a time proportional to that
+ * distance instead of polling now_serving continuously. The two counters
+ * live on separate cache lines so drawing a ticket does not disturb the
+ * line the waiters poll.
+ */
+class ticket_lock {
+	static const unsigned BACKOFF_BASE = 32;
+	static const unsigned YIELD_DISTANCE = 4;
+
+	alignas(CACHELINE_SIZE) std::atomic<unsigned> next_ticket{0};
+	alignas(CACHELINE_SIZE) std::atomic<unsigned> now_serving{0};
+
+public:
+	ticket_lock() = default;
+	ticket_lock(const ticket_lock&) = delete;
+	ticket_lock& operator=(const ticket_lock&) = delete;
+
+	void lock() {
+		unsigned ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+		unsigned spins = 0;
+		while (true) {
+			unsigned serving = now_serving.load(std::memory_order_acquire);
+			if (serving == ticket) {
+				return;
+			}
+			/* unsigned difference, correct across wrap-around */
+			unsigned ahead = ticket - serving;
+			if (ahead > YIELD_DISTANCE) {
+				/* far back in the queue: let the threads ahead of us run */
+				std::this_thread::yield();
+				continue;
+			}
+			spin_then_yield(spins, ahead * BACKOFF_BASE);
+		}
+	}
+
+	void unlock() {
+		/* only the holder writes now_serving */
+		now_serving.store(now_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/* some thread besides the holder has drawn a ticket; call while holding */
+	bool has_waiters() const {
+		return next_ticket.load(std::memory_order_relaxed) - now_serving.load(std::memory_order_relaxed) > 1;
+	}
+};
+
+/* NUMA-aware cohort lock (Dice, Marathe and Shavit, 2012), C-TKT-TKT
+ *
+ * Every NUMA node has a local ticket lock; the global ticket lock is taken
+ * by whichever thread of a node gets there first. On unlock, a holder that
+ * sees a waiter on its own node passes the lock on locally and keeps the
+ * global lock for the cohort, so the protected data stays in that node's
+ * caches. After HANDOFF_LIMIT local passes the global lock is released
+ * anyway, so other nodes are not starved. Ticket locks are used on both
+ * levels since the global one may be released by a different thread than
+ * the one that took it.
+ */
+class cohort_lock {
+	static const unsigned HANDOFF_LIMIT = 64;
+
+	struct alignas(CACHELINE_SIZE) cohort {
+		ticket_lock	local;
+		/* both only touched while holding local */
+		bool		owns_global = false;
+		unsigned	handoffs = 0;
+	};
+
+	ticket_lock	global;
+	cohort		cohorts[MAX_NUMA_NODES];
+	/* cohort of the current holder, only touched by the holder */
+	cohort*		holder = nullptr;
+
+public:
+	cohort_lock() = default;
+	cohort_lock(const cohort_lock&) = delete;
+	cohort_lock& operator=(const cohort_lock&) = delete;
+
+	void lock() {
+		cohort& c = cohorts[numa_node() % MAX_NUMA_NODES];
+		c.local.lock();
+		if (!c.owns_global) {
+			global.lock();
+			c.owns_global = true;
+			c.handoffs = 0;
+		}
+		holder = &c;
+	}
+
+	void unlock() {
+		cohort& c = *holder;
+		if (c.handoffs < HANDOFF_LIMIT && c.local.has_waiters()) {
+			/* the next local holder inherits the global lock */
+			c.handoffs++;
+		} else {
+			c.owns_global = false;
+			global.unlock();
+		}
+		c.local.unlock();
+	}
+};
+
+/* Anderson array-based queue lock (Anderson, 1990)
+ *
+ * Every acquirer takes the next slot of a circular array and spins on its
+ * own flag, each flag on its own cache line; unlock raises the flag of the
+ * following slot. Slots bounds the number of threads that may wait on one
+ * lock at the same time and must be a power of two so the slot counter can
+ * wrap. The default fits MAX_THREADS waiters but costs Slots cache lines
+ * per lock (16 KB); as a per-node lock, size Slots to the thread count.
+ */
+template<std::size_t Slots = MAX_THREADS>
+class anderson_lock {
+	static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of two");
+
+	struct alignas(CACHELINE_SIZE) slot {
+		std::atomic<bool> may_enter{false};
+	};
+
+	slot						slots[Slots];
+	alignas(CACHELINE_SIZE)
+	std::atomic<std::size_t>	tail{0};
+	/* slot of the current holder, only touched by the holder */
+	alignas(CACHELINE_SIZE)
+	std::size_t					holder = 0;
+
+public:
+	anderson_lock() { slots[0].may_enter.store(true, std::memory_order_relaxed); }
+	anderson_lock(const anderson_lock&) = delete;
+	anderson_lock& operator=(const anderson_lock&) = delete;
+
+	void lock() {
+		std::size_t mine = tail.fetch_add(1, std::memory_order_relaxed) % Slots;
+		unsigned spins = 0;
+		while (!slots[mine].may_enter.load(std::memory_order_acquire)) {
+			spin_then_yield(spins);
+		}
+		slots[mine].may_enter.store(false, std::memory_order_relaxed);
+		holder = mine;
+	}
+
+	void unlock() {
+		slots[(holder + 1) % Slots].may_enter.store(true, std::memory_order_release);
+	}
+};
+
+/* sequence lock (sl_par_9.hpp, sorted_vector_set.hpp): writers serialize
+ * on a mutex and bump the sequence number to odd on entry and back to even
+ * on exit. Readers take no lock, they record the sequence number, read, and
+ * retry if it changed.
+ */
+class seq_lock {
+	std::mutex					mutex;
+	alignas(CACHELINE_SIZE) std::atomic<unsigned long>	seq{0};
+
+public:
+	void lock() {
+		mutex.lock();
+		seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	void unlock() {
+		seq.store(seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		mutex.unlock();
+	}
+
+	/* wait for an even sequence number and return it */
+	unsigned long read_begin() const {
+		unsigned long s;
+		while((s = seq.load(std::memory_order_acquire)) & 1) {
+			std::this_thread::yield();
+		}
+		return s;
+	}
+
+	/* true if a writer ran since read_begin() returned s */
+	bool read_retry(unsigned long s) const {
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return seq.load(std::memory_order_relaxed) != s;
+	}
+};
+
+/* queue node for the MCS and CLH locks, padded so that every waiter spins
+ * on its own cache line
+ */
+struct alignas(CACHELINE_SIZE) qnode {
+	std::atomic<qnode*>	next{nullptr};
+	std::atomic<bool>	locked{false};
+};
+
+/* per-thread stock of queue nodes
+ *
+ * Each acquisition takes its own node, so a thread can hold any number of
+ * queue locks at once (hand-over-hand holds two). Nodes are heap allocated
+ * because CLH hands them from thread to thread.
+ */
+class qnode_pool {
+	std::vector<qnode*> nodes;
+
+public:
+	~qnode_pool() {
+		for(auto n : nodes) {
+			heap_allocator::deallocate(n);
+		}
+	}
+
+	static qnode_pool& local() {
+		static thread_local qnode_pool pool;
+		return pool;
+	}
+
+	qnode* get() {
+		if(nodes.empty()) {
+			return heap_allocator::allocate<qnode>();
+		}
+		qnode* n = nodes.back();
+		nodes.pop_back();
+		return n;
+	}
+
+	void put(qnode* n) { nodes.push_back(n); }
+};
+
+/* MCS queue lock (Mellor-Crummey and Scott, 1991)
+ *
+ * Waiters queue up through the next pointers of their own qnodes and spin
+ * locally on their own locked flag; unlock hands the lock to exactly the
+ * next waiter. The qnode either comes from the caller (lock(qnode&), see
+ * mcs_guard) or, for the BasicLockable lock(), from the thread's
+ * qnode_pool, remembered in the lock while it is held.
+ */
+class mcs_mutex {
+	std::atomic<qnode*>	tail{nullptr};
+	/* qnode of the current holder, only touched by the holder */
+	qnode*				holder = nullptr;
+
+public:
+	mcs_mutex() = default;
+	mcs_mutex(const mcs_mutex&) = delete;
+	mcs_mutex& operator=(const mcs_mutex&) = delete;
+
+	void lock(qnode& node) {
+		node.next.store(nullptr, std::memory_order_relaxed);
+		node.locked.store(true, std::memory_order_relaxed);
+
+		qnode* predecessor = tail.exchange(&node, std::memory_order_acq_rel);
+		if (predecessor != nullptr) {
+			predecessor->next.store(&node, std::memory_order_release);
+			while (node.locked.load(std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void unlock(qnode& node) {
+		qnode* successor = node.next.load(std::memory_order_acquire);
+		if (successor == nullptr) {
+			qnode* expected = &node;
+			if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+				return;
+			}
+			/* a successor is between its exchange and linking in */
+			while ((successor = node.next.load(std::memory_order_acquire)) == nullptr) {
+				std::this_thread::yield();
+			}
+		}
+		successor->locked.store(false, std::memory_order_release);
+	}
+
+	void lock() {
+		qnode* node = qnode_pool::local().get();
+		lock(*node);
+		holder = node;
+	}
+
+	void unlock() {
+		qnode* node = holder;
+		unlock(*node);
+		qnode_pool::local().put(node);
+	}
+};
+
+/* scoped MCS acquisition with its qnode on the caller's stack */
+class mcs_guard {
+	mcs_mutex&	mutex;
+	qnode		node;
+
+public:
+	explicit mcs_guard(mcs_mutex& m) : mutex(m) { mutex.lock(node); }
+	~mcs_guard() { mutex.unlock(node); }
+	mcs_guard(const mcs_guard&) = delete;
+	mcs_guard& operator=(const mcs_guard&) = delete;
+};
+
+/* CLH queue lock (Craig; Magnussen, Landin and Hagersten, 1994)
+ *
+ * The queue is implicit: each waiter spins on the locked flag of its
+ * predecessor's qnode. On unlock the releaser gives up its own qnode to
+ * the successor and keeps the predecessor's, which nobody references any
+ * more, for its next acquisition.
+ */
+class clh_mutex {
+	std::atomic<qnode*>	tail;
+	/* only touched by the holder */
+	qnode*				holder = nullptr;
+	qnode*				holder_pred = nullptr;
+
+public:
+	clh_mutex() : tail(heap_allocator::allocate<qnode>()) {}
+	~clh_mutex() { heap_allocator::deallocate(tail.load()); }
+	clh_mutex(const clh_mutex&) = delete;
+	clh_mutex& operator=(const clh_mutex&) = delete;
+
+	void lock() {
+		qnode* node = qnode_pool::local().get();
+		node->locked.store(true, std::memory_order_relaxed);
+		qnode* predecessor = tail.exchange(node, std::memory_order_acq_rel);
+		while (predecessor->locked.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+		holder = node;
+		holder_pred = predecessor;
+	}
+
+	void unlock() {
+		qnode* node = holder;
+		qnode* predecessor = holder_pred;
+		node->locked.store(false, std::memory_order_release);
+		qnode_pool::local().put(predecessor);
+	}
+};
+
+} // namespace lacpp
+
+#endif // lacpp_locks_hpp
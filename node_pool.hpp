@@ -0,0 +1,183 @@
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "thread_index.hpp"
+#ifndef lacpp_node_pool_hpp
+#define lacpp_node_pool_hpp lacpp_node_pool_hpp
+
+/* node allocators for sorted_list<T, Alloc>
+ *
+ * An allocator is a type with two static members:
+ *   template<typename N> static N* allocate();
+ *   template<typename N> static void deallocate(N* n);
+ */
+
+/* raw storage honouring alignof(N), also for over-aligned nodes */
+template<typename N>
+inline void* allocate_storage() {
+	if(alignof(N) <= alignof(std::max_align_t)) {
+		return ::operator new(sizeof(N));
+	}
+	void* p = nullptr;
+	if(posix_memalign(&p, alignof(N), sizeof(N)) != 0) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+template<typename N>
+inline void free_storage(void* p) {
+	if(alignof(N) <= alignof(std::max_align_t)) {
+		::operator delete(p);
+	} else {
+		free(p);
+	}
+}
+
+/* plain heap allocation, one call to the system allocator per node */
+struct heap_allocator {
+	template<typename N>
+	static N* allocate() { return new(allocate_storage<N>()) N(); }
+
+	template<typename N>
+	static void deallocate(N* n) {
+		n->~N();
+		free_storage<N>(n);
+	}
+};
+
+/* pool of node-sized blocks for one node type
+ *
+ * Every thread keeps a private free list, so allocate and free are a
+ * couple of pointer moves without any synchronization. Nodes are carved
+ * from slabs of SLAB_NODES contiguous blocks. A node freed by another
+ * thread than the one that allocated it simply joins the freeing thread's
+ * list; lists that grow past 2 * BATCH hand BATCH blocks back to a shared
+ * depot in one go, and empty lists refill from the depot a batch at a time.
+ */
+template<typename N>
+class node_pool {
+	union block {
+		block*	next;
+		alignas(N) unsigned char storage[sizeof(N)];
+	};
+
+	static const std::size_t BATCH = 64;
+	static const std::size_t SLAB_NODES = 1024;
+
+	struct batch {
+		block*		first;
+		std::size_t	size;
+	};
+
+	struct thread_cache {
+		block*		list = nullptr;
+		std::size_t	size = 0;
+
+		~thread_cache() {
+			/* return whatever is left when the thread exits */
+			if(list != nullptr) {
+				node_pool<N>::instance().push_batch(batch{list, size});
+			}
+		}
+	};
+
+	std::mutex			mutex;
+	std::vector<batch>	depot;
+	std::vector<void*>	slabs;
+
+	static thread_cache& cache() {
+		static thread_local thread_cache c;
+		return c;
+	}
+
+	void push_batch(batch b) {
+		std::lock_guard<std::mutex> lock(mutex);
+		depot.push_back(b);
+	}
+
+	/* refill an empty thread cache from the depot or a fresh slab */
+	void refill(thread_cache& c) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if(!depot.empty()) {
+			batch b = depot.back();
+			depot.pop_back();
+			c.list = b.first;
+			c.size = b.size;
+			return;
+		}
+		void* slab = nullptr;
+		if(posix_memalign(&slab, alignof(block), SLAB_NODES * sizeof(block)) != 0) {
+			throw std::bad_alloc();
+		}
+		slabs.push_back(slab);
+		block* blocks = static_cast<block*>(slab);
+		for(std::size_t i = 0; i < SLAB_NODES; i++) {
+			blocks[i].next = i + 1 < SLAB_NODES ? &blocks[i + 1] : nullptr;
+		}
+		c.list = blocks;
+		c.size = SLAB_NODES;
+	}
+
+public:
+	static node_pool<N>& instance() {
+		static node_pool<N> pool;
+		return pool;
+	}
+
+	node_pool() = default;
+	node_pool(const node_pool&) = delete;
+	node_pool& operator=(const node_pool&) = delete;
+	~node_pool() {
+		for(auto slab : slabs) {
+			free(slab);
+		}
+	}
+
+	void* get() {
+		thread_cache& c = cache();
+		if(c.list == nullptr) {
+			refill(c);
+		}
+		block* b = c.list;
+		c.list = b->next;
+		c.size--;
+		return b;
+	}
+
+	void put(void* p) {
+		thread_cache& c = cache();
+		block* b = static_cast<block*>(p);
+		b->next = c.list;
+		c.list = b;
+		c.size++;
+		if(c.size >= 2 * BATCH) {
+			/* split off BATCH blocks for the depot */
+			block* first = c.list;
+			block* last = first;
+			for(std::size_t i = 1; i < BATCH; i++) {
+				last = last->next;
+			}
+			c.list = last->next;
+			c.size -= BATCH;
+			last->next = nullptr;
+			push_batch(batch{first, BATCH});
+		}
+	}
+};
+
+/* per-thread pooled allocation, see node_pool */
+struct pool_allocator {
+	template<typename N>
+	static N* allocate() { return new(node_pool<N>::instance().get()) N(); }
+
+	template<typename N>
+	static void deallocate(N* n) {
+		n->~N();
+		node_pool<N>::instance().put(n);
+	}
+};
+
+#endif // lacpp_node_pool_hpp
@@ -0,0 +1,89 @@
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sched.h>
+#ifndef lacpp_numa_hpp
+#define lacpp_numa_hpp lacpp_numa_hpp
+
+/* NUMA node of the calling thread, for node-aware locks (see cohort_lock
+ * in locks.hpp)
+ *
+ * The cpu to node map is read once from /sys/devices/system/node; after
+ * that numa_node() is a table lookup on sched_getcpu(), which glibc serves
+ * without a system call. Machines without the sysfs tree (or with a single
+ * node) map every cpu to node 0. The answer may be stale as soon as the
+ * scheduler migrates the thread, which only costs locality, not
+ * correctness.
+ */
+
+static const std::size_t MAX_NUMA_NODES = 8;
+
+class numa_topology {
+	std::vector<std::size_t>	node_of_cpu;
+	std::size_t					nodes = 1;
+
+	/* parse a sysfs cpu list such as "0-3,8-11" */
+	static std::vector<std::size_t> parse_cpulist(const std::string& list) {
+		std::vector<std::size_t> cpus;
+		std::istringstream ss(list);
+		std::string range;
+		while(std::getline(ss, range, ',')) {
+			std::size_t dash = range.find('-');
+			try {
+				std::size_t first = std::stoul(range.substr(0, dash));
+				std::size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+				for(std::size_t c = first; c <= last; c++) {
+					cpus.push_back(c);
+				}
+			} catch(...) {
+				/* malformed entry: ignore it */
+			}
+		}
+		return cpus;
+	}
+
+	numa_topology() {
+		for(std::size_t n = 0; n < MAX_NUMA_NODES; n++) {
+			std::ifstream in("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+			std::string list;
+			if(!in || !std::getline(in, list)) {
+				continue;
+			}
+			for(auto c : parse_cpulist(list)) {
+				if(c >= node_of_cpu.size()) {
+					node_of_cpu.resize(c + 1, 0);
+				}
+				node_of_cpu[c] = n;
+			}
+			if(n + 1 > nodes) {
+				nodes = n + 1;
+			}
+		}
+	}
+
+public:
+	static numa_topology& instance() {
+		static numa_topology topology;
+		return topology;
+	}
+
+	/* number of node ids in use, at most MAX_NUMA_NODES */
+	std::size_t node_count() const { return nodes; }
+
+	/* node of the cpu the caller currently runs on */
+	std::size_t current_node() const {
+		int cpu = sched_getcpu();
+		if(cpu < 0 || static_cast<std::size_t>(cpu) >= node_of_cpu.size()) {
+			return 0;
+		}
+		return node_of_cpu[cpu];
+	}
+};
+
+inline std::size_t numa_node() {
+	return numa_topology::instance().current_node();
+}
+
+#endif // lacpp_numa_hpp
@@ -0,0 +1,109 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "thread_index.hpp"
+#ifndef lacpp_rcu_hpp
+#define lacpp_rcu_hpp lacpp_rcu_hpp
+
+/* userspace read-copy-update (Desnoyers et al., 2012, "memb" flavour)
+ *
+ * A reader stores the current grace period number into its own padded
+ * word on entry and zero on exit; it makes no read-modify-write and, when
+ * the kernel offers membarrier(2), executes no fence either. The missing
+ * reader-side fence is paid for by synchronize(), which forces a memory
+ * barrier on every running thread of the process before it looks at the
+ * reader words, then waits until every reader that entered before the
+ * grace period started has left. Without membarrier, readers fall back to
+ * a full fence after announcing themselves.
+ *
+ * Read-side sections do not nest.
+ */
+class rcu_domain {
+	struct alignas(CACHELINE_SIZE) reader {
+		/* grace period seen on entry, 0 outside a read-side section */
+		std::atomic<std::uint64_t>	period{0};
+	};
+
+	alignas(CACHELINE_SIZE) std::atomic<std::uint64_t> period{1};
+	std::mutex	gp_mutex;
+	reader		readers[MAX_THREADS];
+
+	/* register for expedited membarrier once per process */
+	static bool have_membarrier() {
+		static const bool available = [] {
+			long cmds = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0);
+			if(cmds < 0 || !(cmds & MEMBARRIER_CMD_PRIVATE_EXPEDITED)) {
+				return false;
+			}
+			return syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+		}();
+		return available;
+	}
+
+	const bool	membarrier = have_membarrier();
+
+	/* pairs with the reader-side barrier: a full fence on every thread */
+	void barrier_all() {
+		if(!membarrier || syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0) != 0) {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+	}
+
+public:
+	rcu_domain() = default;
+	rcu_domain(const rcu_domain&) = delete;
+	rcu_domain& operator=(const rcu_domain&) = delete;
+
+	void read_lock() {
+		reader& r = readers[thread_index()];
+		r.period.store(period.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		if(membarrier) {
+			/* keep the compiler from hoisting the traversal above the store */
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+		} else {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+		}
+	}
+
+	void read_unlock() {
+		readers[thread_index()].period.store(0, std::memory_order_release);
+	}
+
+	/* wait until every read-side section that may still see memory unlinked
+	 * before the call has ended; must not be called from inside one
+	 */
+	void synchronize() {
+		std::lock_guard<std::mutex> lock(gp_mutex);
+		barrier_all();
+		std::uint64_t target = period.load(std::memory_order_relaxed) + 1;
+		period.store(target, std::memory_order_relaxed);
+		std::size_t high = thread_index_registry::instance().high_water();
+		for(std::size_t i = 0; i < high; i++) {
+			for(;;) {
+				std::uint64_t p = readers[i].period.load(std::memory_order_acquire);
+				if(p == 0 || p >= target) {
+					break;
+				}
+				std::this_thread::yield();
+			}
+		}
+	}
+};
+
+/* scoped read-side section */
+class rcu_guard {
+	rcu_domain& domain;
+
+public:
+	explicit rcu_guard(rcu_domain& d) : domain(d) { domain.read_lock(); }
+	~rcu_guard() { domain.read_unlock(); }
+	rcu_guard(const rcu_guard&) = delete;
+	rcu_guard& operator=(const rcu_guard&) = delete;
+};
+
+#endif // lacpp_rcu_hpp
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "sorted_list.hpp"
+#include "thread_index.hpp"
+#ifndef lacpp_sharded_list_hpp
+#define lacpp_sharded_list_hpp lacpp_sharded_list_hpp
+
+/* key-range sharded sorted list
+ *
+ * The key range [lo, hi) is split into Shards sub-ranges, each held in its
+ * own sequential List behind its own Lock, so operations on keys in
+ * different shards never touch the same lock or the same nodes. Keys
+ * outside [lo, hi) go to the first or last shard.
+ *
+ * Shard boundaries start out evenly spaced. A sample of the keys that are
+ * operated on is kept in a histogram, and rebalance() moves the boundaries
+ * to equalize the observed load per shard. Rebalancing needs integral keys
+ * since it moves values key by key between neighbouring shards.
+ */
+template<typename T, typename Lock = std::mutex, std::size_t Shards = 16, typename List = sorted_list<T>>
+class sharded_list {
+	static const std::size_t HISTOGRAM_BINS = 1024;
+	static const unsigned SAMPLE_INTERVAL = 32;
+
+	struct alignas(CACHELINE_SIZE) shard {
+		Lock	lock;
+		List	list;
+	};
+
+	const T lo;
+	const T hi;
+	shard shards[Shards];
+	/* bounds[i] is the smallest key of shard i + 1 */
+	std::atomic<T> bounds[Shards - 1];
+	/* bumped while all shards are locked, whenever bounds change */
+	alignas(CACHELINE_SIZE) std::atomic<unsigned long> version{0};
+	std::atomic<unsigned long> histogram[HISTOGRAM_BINS];
+
+	std::size_t shard_of(T v) const {
+		std::size_t first = 0;
+		std::size_t last = Shards - 1;
+		/* first i with v < bounds[i], or Shards - 1 */
+		while(first < last) {
+			std::size_t mid = (first + last) / 2;
+			if(v < bounds[mid].load(std::memory_order_relaxed)) {
+				last = mid;
+			} else {
+				first = mid + 1;
+			}
+		}
+		return first;
+	}
+
+	std::size_t bin_of(T v) const {
+		if(v < lo) return 0;
+		if(!(v < hi)) return HISTOGRAM_BINS - 1;
+		return static_cast<std::size_t>(double(v - lo) * HISTOGRAM_BINS / double(hi - lo));
+	}
+
+	/* lower edge of histogram bin b */
+	T bin_edge(std::size_t b) const {
+		return lo + static_cast<T>(double(hi - lo) * b / HISTOGRAM_BINS);
+	}
+
+	/* lock and return the shard currently responsible for v */
+	std::size_t lock_shard(T v) {
+		while(true) {
+			unsigned long seen = version.load(std::memory_order_acquire);
+			std::size_t i = shard_of(v);
+			shards[i].lock.lock();
+			if(version.load(std::memory_order_relaxed) == seen) {
+				return i;
+			}
+			/* a rebalance moved the boundaries */
+			shards[i].lock.unlock();
+		}
+	}
+
+	/* lock the shards currently responsible for [lo, hi], in shard order */
+	void lock_shards(T lo, T hi, std::size_t& first, std::size_t& last) {
+		while(true) {
+			unsigned long seen = version.load(std::memory_order_acquire);
+			first = shard_of(lo);
+			last = shard_of(hi);
+			for(std::size_t i = first; i <= last; i++) {
+				shards[i].lock.lock();
+			}
+			if(version.load(std::memory_order_relaxed) == seen) {
+				return;
+			}
+			/* a rebalance moved the boundaries */
+			for(std::size_t i = first; i <= last; i++) {
+				shards[i].lock.unlock();
+			}
+		}
+	}
+
+	void sample(T v) {
+		static thread_local unsigned ops = 0;
+		if(++ops % SAMPLE_INTERVAL == 0) {
+			histogram[bin_of(v)].fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+public:
+	sharded_list(T lo, T hi) : lo(lo), hi(hi) {
+		for(std::size_t i = 0; i + 1 < Shards; i++) {
+			bounds[i].store(bin_edge((i + 1) * HISTOGRAM_BINS / Shards), std::memory_order_relaxed);
+		}
+		for(auto& h : histogram) {
+			h.store(0, std::memory_order_relaxed);
+		}
+	}
+	/* build from the values in [begin, end), sorted or not: each shard gets
+	 * its slice of the sorted values in one insert_many pass
+	 */
+	template<typename InputIt>
+	sharded_list(T lo, T hi, InputIt begin, InputIt end) : sharded_list(lo, hi) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		std::size_t first = 0;
+		for(std::size_t i = 0; i < Shards; i++) {
+			std::size_t last = values.size();
+			if(i + 1 < Shards) {
+				T bound = bounds[i].load(std::memory_order_relaxed);
+				last = std::lower_bound(values.begin() + first, values.end(), bound) - values.begin();
+			}
+			shards[i].list.insert_many(values.data() + first, last - first);
+			first = last;
+		}
+	}
+	sharded_list(const sharded_list&) = delete;
+	sharded_list& operator=(const sharded_list&) = delete;
+
+	/* remove all elements, with all shards locked so it is one atomic step */
+	void clear() {
+		for(auto& s : shards) {
+			s.lock.lock();
+		}
+		for(auto& s : shards) {
+			s.list.clear();
+		}
+		for(auto& s : shards) {
+			s.lock.unlock();
+		}
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		sample(v);
+		std::size_t i = lock_shard(v);
+		shards[i].list.insert(v);
+		shards[i].lock.unlock();
+	}
+
+	void remove(T v) {
+		sample(v);
+		std::size_t i = lock_shard(v);
+		shards[i].list.remove(v);
+		shards[i].lock.unlock();
+	}
+
+	/* count elements with value v in the list */
+	std::size_t count(T v) {
+		sample(v);
+		std::size_t i = lock_shard(v);
+		std::size_t cnt = shards[i].list.count(v);
+		shards[i].lock.unlock();
+		return cnt;
+	}
+
+	/* call fn(value) for each element with lo <= value < hi, in order, as one
+	 * atomic step: all shards overlapping the range stay locked throughout.
+	 * fn must not call back into the list.
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		if(!(lo < hi)) {
+			return;
+		}
+		std::size_t first;
+		std::size_t last;
+		lock_shards(lo, hi, first, last);
+		for(std::size_t i = first; i <= last; i++) {
+			shards[i].list.for_each_in_range(lo, hi, fn);
+		}
+		for(std::size_t i = first; i <= last; i++) {
+			shards[i].lock.unlock();
+		}
+	}
+
+	/* count elements with lo <= value < hi */
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	/* the elements with lo <= value < hi, in order, as of one point in time */
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> values;
+		for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+		return values;
+	}
+
+	/* move shard boundaries to the quantiles of the sampled keys */
+	void rebalance() {
+		for(auto& s : shards) {
+			s.lock.lock();
+		}
+
+		unsigned long total = 0;
+		for(auto& h : histogram) {
+			total += h.load(std::memory_order_relaxed);
+		}
+		if(total != 0) {
+			T old_bounds[Shards - 1];
+			T new_bounds[Shards - 1];
+			unsigned long seen = 0;
+			std::size_t b = 0;
+			for(std::size_t i = 0; i + 1 < Shards; i++) {
+				unsigned long target = total * (i + 1) / Shards;
+				while(b < HISTOGRAM_BINS && seen < target) {
+					seen += histogram[b++].load(std::memory_order_relaxed);
+				}
+				old_bounds[i] = bounds[i].load(std::memory_order_relaxed);
+				new_bounds[i] = bin_edge(b);
+			}
+
+			/* publish the new boundaries, then move the keys in between */
+			for(std::size_t i = 0; i + 1 < Shards; i++) {
+				bounds[i].store(new_bounds[i], std::memory_order_relaxed);
+			}
+			version.fetch_add(1, std::memory_order_release);
+			for(std::size_t i = 0; i + 1 < Shards; i++) {
+				T from = old_bounds[i] < new_bounds[i] ? old_bounds[i] : new_bounds[i];
+				T to = old_bounds[i] < new_bounds[i] ? new_bounds[i] : old_bounds[i];
+				for(T k = from; k < to; k++) {
+					/* k's old shard, with the old boundaries */
+					std::size_t src = 0;
+					while(src + 1 < Shards && !(k < old_bounds[src])) {
+						src++;
+					}
+					std::size_t dst = shard_of(k);
+					if(src == dst) {
+						continue;
+					}
+					for(std::size_t c = shards[src].list.count(k); c > 0; c--) {
+						shards[src].list.remove(k);
+						shards[dst].list.insert(k);
+					}
+				}
+			}
+
+			/* age the samples so the boundaries follow shifting load */
+			for(auto& h : histogram) {
+				h.store(h.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+			}
+		}
+
+		for(auto& s : shards) {
+			s.lock.unlock();
+		}
+	}
+};
+
+#endif // lacpp_sharded_list_hpp
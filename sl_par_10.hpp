@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "epoch.hpp"
+#ifndef lacpp_sl_hpp_10
+#define lacpp_sl_hpp_10 lacpp_sl_hpp_10
+
+/* lazy concurrent skip list after Herlihy, Lev, Luchangco and Shavit (2007)
+ *
+ * Search walks down the levels without locks, so insert/remove/count cost
+ * O(log n) pointer chases instead of O(n). Writers lock the predecessors
+ * of the affected levels and validate them; count() takes no locks.
+ *
+ * The original algorithm stores a set. To keep duplicates, nodes are
+ * ordered by (value, node address): every inserted node has a distinct
+ * key, and all copies of a value are adjacent on the bottom level.
+ */
+
+static const int SKIPLIST_MAX_LEVEL = 16;
+
+/* struct for list nodes */
+template<typename T>
+struct node {
+	T						value;
+	int						top_level;
+	std::atomic<bool>		marked{false};
+	std::atomic<bool>		fully_linked{false};
+	std::mutex				mutex;
+	std::atomic<node<T>*>	next[SKIPLIST_MAX_LEVEL];
+};
+
+/* concurrent sorted skip list */
+template<typename T>
+class sorted_list {
+	/* sentinel, its value is never looked at */
+	node<T>			head;
+	epoch_domain	epoch;
+
+	/* key order: by value, ties broken by node address */
+	static bool less(node<T>* n, T v, node<T>* id) {
+		return n->value < v || (n->value == v
+			&& reinterpret_cast<std::uintptr_t>(n) < reinterpret_cast<std::uintptr_t>(id));
+	}
+
+	/* fill preds/succs with the nodes around key (v, id) on every level */
+	void find(T v, node<T>* id, node<T>** preds, node<T>** succs) {
+		node<T>* pred = &head;
+		for(int level = SKIPLIST_MAX_LEVEL - 1; level >= 0; level--) {
+			node<T>* curr = pred->next[level].load();
+			while(curr != nullptr && less(curr, v, id)) {
+				pred = curr;
+				curr = pred->next[level].load();
+			}
+			preds[level] = pred;
+			succs[level] = curr;
+		}
+	}
+
+	/* lock preds[0..top], each distinct node once; returns the highest level locked */
+	static int lock_preds(node<T>** preds, int top) {
+		node<T>* prev = nullptr;
+		int highest = -1;
+		for(int level = 0; level <= top; level++) {
+			if(preds[level] != prev) {
+				preds[level]->mutex.lock();
+				prev = preds[level];
+			}
+			highest = level;
+		}
+		return highest;
+	}
+
+	static void unlock_preds(node<T>** preds, int highest) {
+		node<T>* prev = nullptr;
+		for(int level = 0; level <= highest; level++) {
+			if(preds[level] != prev) {
+				preds[level]->mutex.unlock();
+				prev = preds[level];
+			}
+		}
+	}
+
+	/* geometric level distribution with p = 1/2 */
+	static int random_level() {
+		static thread_local std::mt19937 engine(std::random_device{}());
+		std::uint32_t bits = engine();
+		int level = 0;
+		while((bits & 1) && level < SKIPLIST_MAX_LEVEL - 1) {
+			level++;
+			bits >>= 1;
+		}
+		return level;
+	}
+
+public:
+	/* default constructor only; copying and moving are deleted, since
+	 * a member-wise copy would alias the nodes and free them twice
+	 * (see sl_par_14.hpp for a list with O(1) copies and snapshots)
+	 */
+	sorted_list() {
+		head.top_level = SKIPLIST_MAX_LEVEL - 1;
+		for(auto& n : head.next) {
+			n.store(nullptr, std::memory_order_relaxed);
+		}
+	}
+	sorted_list(const sorted_list<T>& other) = delete;
+	sorted_list(sorted_list<T>&& other) = delete;
+	sorted_list<T>& operator=(const sorted_list<T>& other) = delete;
+	sorted_list<T>& operator=(sorted_list<T>&& other) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n):
+	 * nodes are allocated in list order and appended to every level they
+	 * reach, with no searching or locking
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) : sorted_list() {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		std::vector<node<T>*> nodes;
+		nodes.reserve(values.size());
+		for(auto& v : values) {
+			node<T>* n = new node<T>();
+			n->value = v;
+			n->top_level = random_level();
+			n->fully_linked.store(true, std::memory_order_relaxed);
+			nodes.push_back(n);
+		}
+		/* copies of a value are ordered by address */
+		std::sort(nodes.begin(), nodes.end(), [](node<T>* a, node<T>* b) { return less(a, b->value, b); });
+
+		node<T>* last[SKIPLIST_MAX_LEVEL];
+		std::fill(last, last + SKIPLIST_MAX_LEVEL, &head);
+		for(auto n : nodes) {
+			for(int level = 0; level <= n->top_level; level++) {
+				last[level]->next[level].store(n, std::memory_order_relaxed);
+				last[level] = n;
+			}
+		}
+		for(int level = 0; level < SKIPLIST_MAX_LEVEL; level++) {
+			last[level]->next[level].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+	~sorted_list() {
+		/* no concurrent users left: free the bottom level directly */
+		node<T>* curr = head.next[0].load();
+		while(curr != nullptr) {
+			node<T>* next = curr->next[0].load();
+			delete curr;
+			curr = next;
+		}
+	}
+
+	/* remove all elements by removing the first live one until the list is
+	 * empty; each step only touches the front of the list, so this is O(n)
+	 * overall. Like any series of removes it is not one atomic step.
+	 */
+	void clear() {
+		while(true) {
+			T v;
+			{
+				epoch_guard guard(epoch);
+				node<T>* first = head.next[0].load();
+				while(first != nullptr && (first->marked.load() || !first->fully_linked.load())) {
+					first = first->next[0].load();
+				}
+				if(first == nullptr) {
+					return;
+				}
+				v = first->value;
+			}
+			remove(v);
+		}
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		/* construct new node */
+		node<T>* new_node = new node<T>();
+		new_node->value = v;
+		new_node->top_level = random_level();
+		int top = new_node->top_level;
+
+		node<T>* preds[SKIPLIST_MAX_LEVEL];
+		node<T>* succs[SKIPLIST_MAX_LEVEL];
+		epoch_guard guard(epoch);
+		while(true) {
+			find(v, new_node, preds, succs);
+			int highest = lock_preds(preds, top);
+			bool valid = true;
+			for(int level = 0; valid && level <= top; level++) {
+				node<T>* succ = succs[level];
+				valid = !preds[level]->marked.load()
+					&& (succ == nullptr || !succ->marked.load())
+					&& preds[level]->next[level].load() == succ;
+			}
+			if(!valid) {
+				unlock_preds(preds, highest);
+				continue;
+			}
+			/* link bottom-up, then publish */
+			for(int level = 0; level <= top; level++) {
+				new_node->next[level].store(succs[level], std::memory_order_relaxed);
+			}
+			for(int level = 0; level <= top; level++) {
+				preds[level]->next[level].store(new_node);
+			}
+			new_node->fully_linked.store(true);
+			unlock_preds(preds, highest);
+			return;
+		}
+	}
+
+	void remove(T v) {
+		node<T>* preds[SKIPLIST_MAX_LEVEL];
+		node<T>* succs[SKIPLIST_MAX_LEVEL];
+		node<T>* victim = nullptr;
+		epoch_guard guard(epoch);
+		while(true) {
+			if(victim == nullptr) {
+				/* pick the first live copy of v on the bottom level */
+				find(v, nullptr, preds, succs);
+				node<T>* curr = succs[0];
+				while(curr != nullptr && curr->value == v
+						&& (curr->marked.load() || !curr->fully_linked.load())) {
+					curr = curr->next[0].load();
+				}
+				if(curr == nullptr || curr->value != v) {
+					/* v not found */
+					return;
+				}
+				curr->mutex.lock();
+				if(curr->marked.load()) {
+					/* someone else is removing this copy */
+					curr->mutex.unlock();
+					continue;
+				}
+				curr->marked.store(true);
+				victim = curr;
+			}
+			int top = victim->top_level;
+			find(v, victim, preds, succs);
+			int highest = lock_preds(preds, top);
+			bool valid = true;
+			for(int level = 0; valid && level <= top; level++) {
+				valid = !preds[level]->marked.load()
+					&& preds[level]->next[level].load() == victim;
+			}
+			if(!valid) {
+				unlock_preds(preds, highest);
+				continue;
+			}
+			/* unlink top-down */
+			for(int level = top; level >= 0; level--) {
+				preds[level]->next[level].store(victim->next[level].load());
+			}
+			victim->mutex.unlock();
+			unlock_preds(preds, highest);
+			epoch.retire(victim);
+			return;
+		}
+	}
+
+	/* count elements with value v in the list, without taking any lock */
+	std::size_t count(T v) {
+		epoch_guard guard(epoch);
+		std::size_t cnt = 0;
+		/* first go down to value v */
+		node<T>* pred = &head;
+		node<T>* curr = nullptr;
+		for(int level = SKIPLIST_MAX_LEVEL - 1; level >= 0; level--) {
+			curr = pred->next[level].load();
+			while(curr != nullptr && curr->value < v) {
+				pred = curr;
+				curr = pred->next[level].load();
+			}
+		}
+		/* count live elements on the bottom level */
+		while(curr != nullptr && curr->value == v) {
+			if(curr->fully_linked.load() && !curr->marked.load()) {
+				cnt++;
+			}
+			curr = curr->next[0].load();
+		}
+		return cnt;
+	}
+};
+
+#endif // lacpp_sl_hpp_10
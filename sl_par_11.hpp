@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "epoch.hpp"
+#ifndef lacpp_sl_hpp_11
+#define lacpp_sl_hpp_11 lacpp_sl_hpp_11
+
+/* run-length sorted multiset
+ *
+ * Each distinct value is a single node carrying its multiplicity, so the
+ * list never grows beyond the number of distinct keys, count() is one load
+ * once the key is found, and insert/remove of a present key only update
+ * the counter under that node's lock. Nodes are only linked in or out when
+ * a value first appears or its last copy goes; that part follows the lazy
+ * list in sl_par_7.hpp (lock pred and curr, validate, marked flag).
+ */
+
+/* struct for list nodes */
+template<typename T>
+struct node {
+	T							value;
+	std::atomic<std::size_t>	multiplicity{1};
+	std::atomic<node<T>*>		next{nullptr};
+	std::atomic<bool>			marked{false};
+	std::mutex					mutex;
+};
+
+/* sorted multiset as a singly-linked list of (value, multiplicity) */
+template<typename T>
+class sorted_list {
+	/* sentinel, its value is never looked at */
+	node<T>			head;
+	epoch_domain	epoch;
+
+	/* find pred, curr with pred->value < v <= curr->value without locking */
+	void find(T v, node<T>*& pred, node<T>*& curr) {
+		pred = &head;
+		curr = head.next.load();
+		while(curr != nullptr && curr->value < v) {
+			pred = curr;
+			curr = curr->next.load();
+		}
+	}
+
+public:
+	/* default constructor only; copying and moving are deleted, since
+	 * a member-wise copy would alias the nodes and free them twice
+	 * (see sl_par_14.hpp for a list with O(1) copies and snapshots)
+	 */
+	sorted_list() = default;
+	sorted_list(const sorted_list<T>& other) = delete;
+	sorted_list(sorted_list<T>&& other) = delete;
+	sorted_list<T>& operator=(const sorted_list<T>& other) = delete;
+	sorted_list<T>& operator=(sorted_list<T>&& other) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * one node per distinct value, allocated in list order
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		std::atomic<node<T>*>* link = &head.next;
+		for(std::size_t i = 0; i < values.size(); ) {
+			std::size_t run = 1;
+			while(i + run < values.size() && values[i + run] == values[i]) {
+				run++;
+			}
+			node<T>* current = new node<T>();
+			current->value = values[i];
+			current->multiplicity.store(run, std::memory_order_relaxed);
+			link->store(current, std::memory_order_relaxed);
+			link = &current->next;
+			i += run;
+		}
+	}
+	~sorted_list() {
+		/* no concurrent users left: free the chain directly */
+		node<T>* curr = head.next.load();
+		while(curr != nullptr) {
+			node<T>* next = curr->next.load();
+			delete curr;
+			curr = next;
+		}
+	}
+
+	/* remove all elements as one atomic step: lock the sentinel and then
+	 * every node front to back (the order writers lock in), mark them all and
+	 * cut the chain off the sentinel. Readers skip marked nodes and writers
+	 * fail validation on them, so nodes are retired rather than freed.
+	 */
+	void clear() {
+		epoch_guard guard(epoch);
+		head.mutex.lock();
+		node<T>* first = head.next.load();
+		for(node<T>* curr = first; curr != nullptr; curr = curr->next.load()) {
+			curr->mutex.lock();
+			curr->marked.store(true);
+		}
+		head.next.store(nullptr);
+		head.mutex.unlock();
+		while(first != nullptr) {
+			node<T>* next = first->next.load();
+			first->mutex.unlock();
+			epoch.retire(first);
+			first = next;
+		}
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		epoch_guard guard(epoch);
+		while(true) {
+			node<T>* pred;
+			node<T>* curr;
+			find(v, pred, curr);
+			if(curr != nullptr && curr->value == v) {
+				/* v already present: one more copy */
+				std::lock_guard<std::mutex> curr_lock(curr->mutex);
+				if(!curr->marked.load()) {
+					curr->multiplicity.fetch_add(1);
+					return;
+				}
+				continue;
+			}
+			std::lock_guard<std::mutex> pred_lock(pred->mutex);
+			if(!pred->marked.load() && pred->next.load() == curr) {
+				/* first copy: insert new node between pred and curr */
+				node<T>* new_node = new node<T>();
+				new_node->value = v;
+				new_node->next.store(curr, std::memory_order_relaxed);
+				pred->next.store(new_node);
+				return;
+			}
+		}
+	}
+
+	void remove(T v) {
+		epoch_guard guard(epoch);
+		while(true) {
+			node<T>* pred;
+			node<T>* curr;
+			find(v, pred, curr);
+			if(curr == nullptr || curr->value != v) {
+				/* v not found */
+				return;
+			}
+			{
+				/* more than one copy: only the counter changes */
+				std::lock_guard<std::mutex> curr_lock(curr->mutex);
+				if(curr->marked.load()) {
+					continue;
+				}
+				std::size_t m = curr->multiplicity.load();
+				if(m > 1) {
+					curr->multiplicity.store(m - 1);
+					return;
+				}
+			}
+			/* last copy: unlink the node, locking pred before curr */
+			std::lock_guard<std::mutex> pred_lock(pred->mutex);
+			std::lock_guard<std::mutex> curr_lock(curr->mutex);
+			if(pred->marked.load() || curr->marked.load() || pred->next.load() != curr) {
+				continue;
+			}
+			std::size_t m = curr->multiplicity.load();
+			if(m > 1) {
+				/* copies were added meanwhile */
+				curr->multiplicity.store(m - 1);
+				return;
+			}
+			curr->marked.store(true);
+			pred->next.store(curr->next.load());
+			epoch.retire(curr);
+			return;
+		}
+	}
+
+	/* count elements with value v in the list, without taking any lock */
+	std::size_t count(T v) {
+		epoch_guard guard(epoch);
+		/* first go to value v */
+		node<T>* curr = head.next.load();
+		while(curr != nullptr && curr->value < v) {
+			curr = curr->next.load();
+		}
+		if(curr == nullptr || curr->value != v || curr->marked.load()) {
+			return 0;
+		}
+		return curr->multiplicity.load();
+	}
+
+	/* call fn(value) for each element with lo <= value < hi, in order, once
+	 * per copy, as one atomic step: lock pred and check it is still in the
+	 * list, then lock the nodes of the range front to back (the order
+	 * writers lock in) and keep them locked until the end, which also
+	 * freezes their multiplicities. fn runs under the node locks and must
+	 * not call back into the list.
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		epoch_guard guard(epoch);
+		while(true) {
+			node<T>* pred;
+			node<T>* curr;
+			find(lo, pred, curr);
+			pred->mutex.lock();
+			if(pred->marked.load()) {
+				pred->mutex.unlock();
+				continue;
+			}
+			/* nodes reached from a locked live pred are live, and stay so */
+			curr = pred->next.load();
+			while(curr != nullptr && curr->value < hi) {
+				curr->mutex.lock();
+				if(!(curr->value < lo)) {
+					for(std::size_t m = curr->multiplicity.load(); m > 0; m--) {
+						fn(curr->value);
+					}
+				}
+				curr = curr->next.load();
+			}
+			for(node<T>* n = pred; n != curr; ) {
+				node<T>* next = n->next.load();
+				n->mutex.unlock();
+				n = next;
+			}
+			return;
+		}
+	}
+
+	/* count elements with lo <= value < hi */
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	/* the elements with lo <= value < hi, in order, as of one point in time */
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> values;
+		for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+		return values;
+	}
+};
+
+#endif // lacpp_sl_hpp_11
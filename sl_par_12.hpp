@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "node_pool.hpp"
+#ifndef lacpp_sl_hpp_12
+#define lacpp_sl_hpp_12 lacpp_sl_hpp_12
+
+/* unrolled sorted list with hand-over-hand locking per chunk
+ *
+ * Values are packed in sorted order into chunks of two cache lines, so a
+ * traversal touches one lock and one cache-line pair per CAPACITY values
+ * instead of per value. Full chunks split in half; a chunk that drains
+ * below a quarter is merged with its successor when both fit in one.
+ *
+ * Searching inside a chunk counts "values[i] < v" or "values[i] == v" over
+ * the whole chunk without branches, which the compiler turns into SIMD
+ * compares at -O3.
+ */
+
+static const std::size_t CHUNK_BYTES = 2 * CACHELINE_SIZE;
+
+/* struct for list chunks */
+template<typename T>
+struct alignas(CACHELINE_SIZE) chunk {
+	static const std::size_t HEADER = sizeof(std::mutex) + sizeof(void*) + sizeof(std::size_t);
+	static const std::size_t CAPACITY = HEADER + 4 * sizeof(T) < CHUNK_BYTES
+		? (CHUNK_BYTES - HEADER) / sizeof(T) : 4;
+
+	std::mutex	mutex;
+	chunk<T>*	next = nullptr;
+	std::size_t	size = 0;
+	T			values[CAPACITY];
+
+	/* number of values smaller than v, i.e. the insert position of v */
+	std::size_t rank(T v) const {
+		std::size_t r = 0;
+		for(std::size_t i = 0; i < size; i++) {
+			r += values[i] < v;
+		}
+		return r;
+	}
+
+	std::size_t count(T v) const {
+		std::size_t cnt = 0;
+		for(std::size_t i = 0; i < size; i++) {
+			cnt += values[i] == v;
+		}
+		return cnt;
+	}
+};
+
+/* concurrent unrolled sorted singly-linked list */
+template<typename T, typename Alloc = heap_allocator>
+class sorted_list {
+	chunk<T>*	head = nullptr;
+	std::mutex	head_mutex;
+
+	static const std::size_t CAPACITY = chunk<T>::CAPACITY;
+
+	/* free a detached chain of chunks in one pass */
+	static void free_chain(chunk<T>* current) {
+		while(current != nullptr) {
+			chunk<T>* next = current->next;
+			Alloc::deallocate(current);
+			current = next;
+		}
+	}
+
+	/* move the upper half of full chunk c into a new chunk linked after it; c must be locked */
+	static void split(chunk<T>* c) {
+		chunk<T>* upper = Alloc::template allocate<chunk<T>>();
+		std::size_t half = c->size / 2;
+		std::copy(c->values + half, c->values + c->size, upper->values);
+		upper->size = c->size - half;
+		c->size = half;
+		upper->next = c->next;
+		c->next = upper;
+	}
+
+	/* fold c->next into c if c ran low and both fit; c must be locked */
+	static void merge(chunk<T>* c) {
+		chunk<T>* next = c->next;
+		if(next == nullptr || c->size >= CAPACITY / 4) {
+			return;
+		}
+		next->mutex.lock();
+		if(c->size + next->size > CAPACITY) {
+			next->mutex.unlock();
+			return;
+		}
+		std::copy(next->values, next->values + next->size, c->values + c->size);
+		c->size += next->size;
+		c->next = next->next;
+		/* nobody else can reach next without holding c */
+		next->mutex.unlock();
+		Alloc::deallocate(next);
+	}
+
+public:
+	/* default constructor only; copying and moving are deleted, since
+	 * a member-wise copy would alias the nodes and free them twice
+	 * (see sl_par_14.hpp for a list with O(1) copies and snapshots)
+	 */
+	sorted_list() = default;
+	sorted_list(const sorted_list& other) = delete;
+	sorted_list(sorted_list&& other) = delete;
+	sorted_list& operator=(const sorted_list& other) = delete;
+	sorted_list& operator=(sorted_list&& other) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * chunks are filled to three quarters, so inserts do not split them
+	 * right away, and allocated in list order
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		const std::size_t fill = CAPACITY - CAPACITY / 4;
+		chunk<T>** link = &head;
+		for(std::size_t i = 0; i < values.size(); i += fill) {
+			chunk<T>* c = Alloc::template allocate<chunk<T>>();
+			c->size = std::min(fill, values.size() - i);
+			std::copy(values.begin() + i, values.begin() + i + c->size, c->values);
+			*link = c;
+			link = &c->next;
+		}
+		*link = nullptr;
+	}
+	~sorted_list() {
+		free_chain(head);
+	}
+
+	/* remove all elements in one pass: detach the chain under the head lock,
+	 * then follow it hand-over-hand, so threads still working in it stay
+	 * ahead of us and every chunk is freed once they have left it
+	 */
+	void clear() {
+		head_mutex.lock();
+		chunk<T>* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+		head = nullptr;
+		head_mutex.unlock();
+
+		while(curr != nullptr) {
+			chunk<T>* next = curr->next;
+			if (next != nullptr) next->mutex.lock();
+			curr->mutex.unlock();
+			Alloc::deallocate(curr);
+			curr = next;
+		}
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		head_mutex.lock();
+		chunk<T>* curr = head;
+		if(curr == nullptr) {
+			/* first value: construct new chunk */
+			curr = Alloc::template allocate<chunk<T>>();
+			curr->values[0] = v;
+			curr->size = 1;
+			head = curr;
+			head_mutex.unlock();
+			return;
+		}
+		curr->mutex.lock();
+		head_mutex.unlock();
+
+		/* stop at the last chunk that starts below v */
+		while(curr->next != nullptr) {
+			chunk<T>* next = curr->next;
+			next->mutex.lock();
+			if(!(next->values[0] < v)) {
+				next->mutex.unlock();
+				break;
+			}
+			curr->mutex.unlock();
+			curr = next;
+		}
+
+		chunk<T>* target = curr;
+		if(curr->size == CAPACITY) {
+			split(curr);
+			/* the new upper half is only reachable through curr, which we hold */
+			if(!(v < curr->next->values[0])) {
+				target = curr->next;
+			}
+		}
+		std::size_t pos = target->rank(v);
+		std::copy_backward(target->values + pos, target->values + target->size,
+			target->values + target->size + 1);
+		target->values[pos] = v;
+		target->size++;
+		curr->mutex.unlock();
+	}
+
+	void remove(T v) {
+		head_mutex.lock();
+		chunk<T>* pred = nullptr;
+		chunk<T>* curr = head;
+		if(curr == nullptr) {
+			head_mutex.unlock();
+			return;
+		}
+		curr->mutex.lock();
+
+		/* find the first chunk whose last value is >= v */
+		while(curr->values[curr->size - 1] < v) {
+			chunk<T>* next = curr->next;
+			if(next == nullptr) {
+				/* v not found */
+				if(pred == nullptr) head_mutex.unlock();
+				else pred->mutex.unlock();
+				curr->mutex.unlock();
+				return;
+			}
+			next->mutex.lock();
+			if(pred == nullptr) head_mutex.unlock();
+			else pred->mutex.unlock();
+			pred = curr;
+			curr = next;
+		}
+
+		std::size_t pos = curr->rank(v);
+		if(curr->values[pos] == v) {
+			std::copy(curr->values + pos + 1, curr->values + curr->size, curr->values + pos);
+			curr->size--;
+			if(curr->size == 0) {
+				/* unlink the empty chunk, pred (or head) is locked */
+				if(pred == nullptr) head = curr->next;
+				else pred->next = curr->next;
+				curr->mutex.unlock();
+				Alloc::deallocate(curr);
+				curr = nullptr;
+			} else {
+				merge(curr);
+			}
+		}
+
+		if(pred == nullptr) head_mutex.unlock();
+		else pred->mutex.unlock();
+		if(curr != nullptr) curr->mutex.unlock();
+	}
+
+	/* count elements with value v in the list */
+	std::size_t count(T v) {
+		std::size_t cnt = 0;
+		head_mutex.lock();
+		chunk<T>* curr = head;
+		if(curr == nullptr) {
+			head_mutex.unlock();
+			return 0;
+		}
+		curr->mutex.lock();
+		head_mutex.unlock();
+
+		while(true) {
+			if(!(curr->values[curr->size - 1] < v)) {
+				cnt += curr->count(v);
+			}
+			/* copies of v may continue in the next chunk */
+			chunk<T>* next = curr->next;
+			if(next == nullptr) {
+				break;
+			}
+			next->mutex.lock();
+			if(v < next->values[0]) {
+				next->mutex.unlock();
+				break;
+			}
+			curr->mutex.unlock();
+			curr = next;
+		}
+		curr->mutex.unlock();
+		return cnt;
+	}
+
+	/* call fn(value) for each element with lo <= value < hi, in order, as one
+	 * atomic step: couple down to the first chunk that may hold lo, then keep
+	 * it, its pred and every following chunk that starts below hi locked
+	 * until the end. Inserts into the range land in one of these chunks.
+	 * fn runs under the chunk locks and must not call back into the list.
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		head_mutex.lock();
+		chunk<T>* pred = nullptr;
+		chunk<T>* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+
+		/* find the first chunk whose last value is >= lo */
+		while(curr != nullptr && curr->values[curr->size - 1] < lo) {
+			chunk<T>* next = curr->next;
+			if (next != nullptr) next->mutex.lock();
+			if (pred == nullptr) head_mutex.unlock();
+			else pred->mutex.unlock();
+			pred = curr;
+			curr = next;
+		}
+
+		/* pred and curr are locked: lock the rest of the range without releasing */
+		chunk<T>* first = curr;
+		while(curr != nullptr && curr->values[0] < hi) {
+			for(std::size_t i = 0; i < curr->size; i++) {
+				if(!(curr->values[i] < lo) && curr->values[i] < hi) {
+					fn(curr->values[i]);
+				}
+			}
+			if (curr->next != nullptr) curr->next->mutex.lock();
+			curr = curr->next;
+		}
+
+		/* release pred, the range and the chunk after it */
+		if (pred == nullptr) head_mutex.unlock();
+		else pred->mutex.unlock();
+		while(first != curr) {
+			chunk<T>* next = first->next;
+			first->mutex.unlock();
+			first = next;
+		}
+		if (curr != nullptr) curr->mutex.unlock();
+	}
+
+	/* count elements with lo <= value < hi */
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	/* the elements with lo <= value < hi, in order, as of one point in time */
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> values;
+		for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+		return values;
+	}
+};
+
+#endif // lacpp_sl_hpp_12
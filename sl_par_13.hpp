@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "locks.hpp"
+#include "node_pool.hpp"
+#ifndef lacpp_sl_hpp_13
+#define lacpp_sl_hpp_13 lacpp_sl_hpp_13
+
+/* hand-over-hand list with a one-byte lock per node
+ *
+ * Same locking as sl_par_2.hpp, but the per-node lock is a byte_lock
+ * packed into the padding after the value instead of a 40 byte std::mutex
+ * on a cache line of its own. A node for int is 16 bytes, so four nodes
+ * share a cache line and a traversal touches a quarter of the memory.
+ */
+
+/* struct for list nodes */
+template<typename T>
+struct node {
+	T					value;
+	lacpp::byte_lock	mutex;
+	node<T>*			next;
+};
+static_assert(sizeof(node<int>) == 16, "node<int> is expected to take 16 bytes");
+
+/* concurrent sorted singly-linked list */
+template<typename T, typename Alloc = heap_allocator>
+class sorted_list {
+	node<T>*			head = nullptr;
+	lacpp::byte_lock	head_mutex;
+
+	/* free a detached chain of nodes in one pass */
+	static void free_chain(node<T>* current) {
+		while(current != nullptr) {
+			node<T>* next = current->next;
+			Alloc::deallocate(current);
+			current = next;
+		}
+	}
+
+public:
+	/* default constructor only; copying and moving are deleted, since
+	 * a member-wise copy would alias the nodes and free them twice
+	 * (see sl_par_14.hpp for a list with O(1) copies and snapshots)
+	 */
+	sorted_list() = default;
+	sorted_list(const sorted_list& other) = delete;
+	sorted_list(sorted_list&& other) = delete;
+	sorted_list& operator=(const sorted_list& other) = delete;
+	sorted_list& operator=(sorted_list&& other) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * nodes are allocated in list order, so neighbours tend to be adjacent
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		node<T>** link = &head;
+		for(auto& v : values) {
+			node<T>* current = Alloc::template allocate<node<T>>();
+			current->value = v;
+			*link = current;
+			link = &current->next;
+		}
+		*link = nullptr;
+	}
+	~sorted_list() {
+		free_chain(head);
+	}
+
+	/* remove all elements in one pass: detach the chain under the head lock,
+	 * then follow it hand-over-hand, so threads still working in it stay
+	 * ahead of us and every node is freed once they have left it
+	 */
+	void clear() {
+		head_mutex.lock();
+		node<T>* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+		head = nullptr;
+		head_mutex.unlock();
+
+		while(curr != nullptr) {
+			node<T>* next = curr->next;
+			if (next != nullptr) next->mutex.lock();
+			curr->mutex.unlock();
+			Alloc::deallocate(curr);
+			curr = next;
+		}
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		head_mutex.lock();
+		node<T>* pred = nullptr;
+		node<T>* succ = head;
+		if (succ != nullptr) succ->mutex.lock();
+
+		while(succ != nullptr && succ->value < v) {
+			if (pred == nullptr) head_mutex.unlock();
+			else pred->mutex.unlock();
+			pred = succ;
+			if (succ->next != nullptr) succ->next->mutex.lock();
+			succ = succ->next;
+		}
+
+		/* construct new node */
+		node<T>* new_node = Alloc::template allocate<node<T>>();
+		new_node->value = v;
+
+		/* insert new node between pred and succ */
+		new_node->next = succ;
+		if(pred == nullptr) {
+			head = new_node;
+			head_mutex.unlock();
+		} else {
+			pred->next = new_node;
+			pred->mutex.unlock();
+		}
+		if (succ != nullptr) succ->mutex.unlock();
+	}
+
+	void remove(T v) {
+		head_mutex.lock();
+		node<T>* pred = nullptr;
+		node<T>* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+
+		while(curr != nullptr && curr->value < v) {
+			if (pred == nullptr) head_mutex.unlock();
+			else pred->mutex.unlock();
+			pred = curr;
+			if (curr->next != nullptr) curr->next->mutex.lock();
+			curr = curr->next;
+		}
+
+		if(curr == nullptr || curr->value != v)
+		{
+			if (pred != nullptr) pred->mutex.unlock();
+			else head_mutex.unlock();
+			if (curr != nullptr) curr->mutex.unlock();
+			return;
+		}
+
+		if(pred == nullptr) {
+			head = curr->next;
+			head_mutex.unlock();
+		} else {
+			pred->next = curr->next;
+			pred->mutex.unlock();
+		}
+
+		curr->mutex.unlock();
+		Alloc::deallocate(curr);
+	}
+
+	/* count elements with value v in the list */
+	std::size_t count(T v) {
+		std::size_t cnt = 0;
+		lacpp::byte_lock* held = &head_mutex;
+		held->lock();
+		node<T>* curr = head;
+
+		while(curr != nullptr && curr->value < v) {
+			curr->mutex.lock();
+			held->unlock();
+			held = &curr->mutex;
+			curr = curr->next;
+		}
+
+		/* count elements */
+		while(curr != nullptr && curr->value == v) {
+			curr->mutex.lock();
+			held->unlock();
+			held = &curr->mutex;
+			cnt++;
+			curr = curr->next;
+		}
+
+		held->unlock();
+		return cnt;
+	}
+
+	/* call fn(value) for each element with lo <= value < hi, in order, as one
+	 * atomic step: every node of the range stays locked until the end, so
+	 * the values seen are the state at the moment the last one was locked.
+	 * fn runs under the node locks and must not call back into the list.
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		head_mutex.lock();
+		node<T>* pred = nullptr;
+		node<T>* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+
+		while(curr != nullptr && curr->value < lo) {
+			if (pred == nullptr) head_mutex.unlock();
+			else pred->mutex.unlock();
+			pred = curr;
+			if (curr->next != nullptr) curr->next->mutex.lock();
+			curr = curr->next;
+		}
+
+		/* pred and curr are locked: lock the rest of the range without releasing */
+		node<T>* first = curr;
+		while(curr != nullptr && curr->value < hi) {
+			fn(curr->value);
+			if (curr->next != nullptr) curr->next->mutex.lock();
+			curr = curr->next;
+		}
+
+		/* release pred, the range and the node after it */
+		if (pred == nullptr) head_mutex.unlock();
+		else pred->mutex.unlock();
+		while(first != curr) {
+			node<T>* next = first->next;
+			first->mutex.unlock();
+			first = next;
+		}
+		if (curr != nullptr) curr->mutex.unlock();
+	}
+
+	/* count elements with lo <= value < hi */
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	/* the elements with lo <= value < hi, in order, as of one point in time */
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> values;
+		for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+		return values;
+	}
+};
+
+#endif // lacpp_sl_hpp_13
@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <mutex>
+#include <vector>
+#include "epoch.hpp"
+#include "node_pool.hpp"
+#ifndef lacpp_sl_hpp_14
+#define lacpp_sl_hpp_14 lacpp_sl_hpp_14
+
+/* persistent sorted list with O(1) snapshots
+ *
+ * Nodes are never modified once published. A writer copies the nodes in
+ * front of the position it changes (path copying), shares the rest of the
+ * chain with the previous version and swings the root; writers serialize
+ * on a mutex, readers take no lock. Every node counts the pointers to it
+ * (from nodes of any version, the root and snapshots), and a chain is
+ * released node by node as long as counts drop to zero.
+ *
+ * snapshot() takes a counted reference to the current root, so a frozen
+ * view costs one increment and its readers never meet a writer. The
+ * root's own reference is dropped through the epoch domain, since live
+ * readers may still be walking the version it pointed to.
+ */
+
+/* struct for list nodes */
+template<typename T>
+struct node {
+	T						value;
+	node<T>*				next = nullptr;
+	std::atomic<std::size_t>	refs{1};
+};
+
+/* drop one reference to n, freeing the chain as far as nobody else holds it */
+template<typename T, typename Alloc>
+void release_chain(node<T>* n) {
+	while(n != nullptr && n->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		node<T>* next = n->next;
+		Alloc::deallocate(n);
+		n = next;
+	}
+}
+
+template<typename T>
+void acquire_node(node<T>* n) {
+	if(n != nullptr) {
+		n->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/* immutable view of one version of a sorted_list */
+template<typename T, typename Alloc = heap_allocator>
+class sorted_list_snapshot {
+	template<typename, typename> friend class sorted_list;
+
+	node<T>*	first = nullptr;
+
+public:
+	class const_iterator {
+		const node<T>* n;
+
+	public:
+		typedef std::forward_iterator_tag	iterator_category;
+		typedef T							value_type;
+		typedef std::ptrdiff_t				difference_type;
+		typedef const T*					pointer;
+		typedef const T&					reference;
+
+		explicit const_iterator(const node<T>* n = nullptr) : n(n) {}
+		reference operator*() const { return n->value; }
+		pointer operator->() const { return &n->value; }
+		const_iterator& operator++() { n = n->next; return *this; }
+		const_iterator operator++(int) { const_iterator old = *this; n = n->next; return old; }
+		bool operator==(const const_iterator& other) const { return n == other.n; }
+		bool operator!=(const const_iterator& other) const { return n != other.n; }
+	};
+
+	sorted_list_snapshot() = default;
+	/* takes over one reference to first */
+	explicit sorted_list_snapshot(node<T>* first) : first(first) {}
+	sorted_list_snapshot(const sorted_list_snapshot& other) : first(other.first) {
+		acquire_node(first);
+	}
+	sorted_list_snapshot(sorted_list_snapshot&& other) : first(other.first) {
+		other.first = nullptr;
+	}
+	sorted_list_snapshot& operator=(sorted_list_snapshot other) {
+		std::swap(first, other.first);
+		return *this;
+	}
+	~sorted_list_snapshot() {
+		release_chain<T, Alloc>(first);
+	}
+
+	const_iterator begin() const { return const_iterator(first); }
+	const_iterator end() const { return const_iterator(); }
+
+	/* count elements with value v in the snapshot */
+	std::size_t count(T v) const {
+		std::size_t cnt = 0;
+		const node<T>* current = first;
+		while(current != nullptr && current->value < v) {
+			current = current->next;
+		}
+		while(current != nullptr && current->value == v) {
+			cnt++;
+			current = current->next;
+		}
+		return cnt;
+	}
+
+	/* count elements with lo <= value < hi */
+	std::size_t count_range(T lo, T hi) const {
+		std::size_t cnt = 0;
+		const node<T>* current = first;
+		while(current != nullptr && current->value < lo) {
+			current = current->next;
+		}
+		while(current != nullptr && current->value < hi) {
+			cnt++;
+			current = current->next;
+		}
+		return cnt;
+	}
+};
+
+/* concurrent sorted list with copy-on-write versions */
+template<typename T, typename Alloc = heap_allocator>
+class sorted_list {
+	std::atomic<node<T>*>	root{nullptr};
+	std::mutex				mutex;
+	mutable epoch_domain	epoch;
+
+	static void release_root(void* p) {
+		release_chain<T, Alloc>(static_cast<node<T>*>(p));
+	}
+
+	/* copy the nodes in front of stop, linking the last copy to tail; returns
+	 * the new first node. The copies start out with one reference each, the
+	 * caller provides the one to tail.
+	 */
+	static node<T>* copy_prefix(node<T>* first, node<T>* stop, node<T>* tail) {
+		node<T>* copy = nullptr;
+		node<T>** link = &copy;
+		for(node<T>* n = first; n != stop; n = n->next) {
+			node<T>* c = Alloc::template allocate<node<T>>();
+			c->value = n->value;
+			*link = c;
+			link = &c->next;
+		}
+		*link = tail;
+		return copy;
+	}
+
+	/* publish a new root; mutex must be held */
+	void replace_root(node<T>* first) {
+		node<T>* old = root.exchange(first, std::memory_order_acq_rel);
+		if(old != nullptr) {
+			/* readers may still walk the old version */
+			epoch_guard guard(epoch);
+			epoch.retire(old, &release_root);
+		}
+	}
+
+public:
+	typedef sorted_list_snapshot<T, Alloc> snapshot_type;
+
+	sorted_list() = default;
+	/* O(1): the copy shares every node with other */
+	sorted_list(const sorted_list& other) {
+		snapshot_type s = other.snapshot();
+		root.store(s.first, std::memory_order_relaxed);
+		s.first = nullptr;
+	}
+	sorted_list& operator=(const sorted_list& other) {
+		if(this != &other) {
+			*this = other.snapshot();
+		}
+		return *this;
+	}
+	/* O(1): make the version seen by s the current one */
+	sorted_list& operator=(const snapshot_type& s) {
+		std::lock_guard<std::mutex> lock(mutex);
+		acquire_node(s.first);
+		replace_root(s.first);
+		return *this;
+	}
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * nodes are allocated in list order, so neighbours tend to be adjacent
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		node<T>* first = nullptr;
+		node<T>** link = &first;
+		for(auto& v : values) {
+			node<T>* current = Alloc::template allocate<node<T>>();
+			current->value = v;
+			*link = current;
+			link = &current->next;
+		}
+		root.store(first, std::memory_order_relaxed);
+	}
+	~sorted_list() {
+		release_chain<T, Alloc>(root.load());
+	}
+
+	/* the current version, in O(1) */
+	snapshot_type snapshot() const {
+		epoch_guard guard(epoch);
+		node<T>* first = root.load(std::memory_order_acquire);
+		acquire_node(first);
+		return snapshot_type(first);
+	}
+
+	/* remove all elements */
+	void clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		replace_root(nullptr);
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		std::lock_guard<std::mutex> lock(mutex);
+		node<T>* first = root.load(std::memory_order_relaxed);
+		node<T>* succ = first;
+		while(succ != nullptr && succ->value < v) {
+			succ = succ->next;
+		}
+
+		/* construct new node in front of succ, then copy the path to it */
+		node<T>* current = Alloc::template allocate<node<T>>();
+		current->value = v;
+		current->next = succ;
+		acquire_node(succ);
+		replace_root(copy_prefix(first, succ, current));
+	}
+
+	void remove(T v) {
+		std::lock_guard<std::mutex> lock(mutex);
+		node<T>* first = root.load(std::memory_order_relaxed);
+		node<T>* current = first;
+		while(current != nullptr && current->value < v) {
+			current = current->next;
+		}
+		if(current == nullptr || current->value != v) {
+			/* v not found */
+			return;
+		}
+		/* the copies link past current; the old version keeps it alive */
+		acquire_node(current->next);
+		replace_root(copy_prefix(first, current, current->next));
+	}
+
+	/* count elements with value v in the list, without taking any lock */
+	std::size_t count(T v) {
+		epoch_guard guard(epoch);
+		std::size_t cnt = 0;
+		/* first go to value v */
+		node<T>* current = root.load(std::memory_order_acquire);
+		while(current != nullptr && current->value < v) {
+			current = current->next;
+		}
+		/* count elements */
+		while(current != nullptr && current->value == v) {
+			cnt++;
+			current = current->next;
+		}
+		return cnt;
+	}
+
+	/* call fn on every element with lo <= value < hi, in order; all of them
+	 * come from one version, so the range is linearizable without any lock
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		epoch_guard guard(epoch);
+		node<T>* current = root.load(std::memory_order_acquire);
+		while(current != nullptr && current->value < lo) {
+			current = current->next;
+		}
+		while(current != nullptr && current->value < hi) {
+			fn(current->value);
+			current = current->next;
+		}
+	}
+
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> out;
+		for_each_in_range(lo, hi, [&out](const T& v) { out.push_back(v); });
+		return out;
+	}
+};
+
+#endif // lacpp_sl_hpp_14
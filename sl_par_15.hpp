@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "node_pool.hpp"
+#include "rcu.hpp"
+#ifndef lacpp_sl_hpp_15
+#define lacpp_sl_hpp_15 lacpp_sl_hpp_15
+
+/* RCU-protected sorted list
+ *
+ * count() runs inside an RCU read-side section (see rcu.hpp): it stores
+ * to its own reader word on entry and exit and otherwise only loads, so
+ * readers share no written cache line and scale with their number.
+ * Writers serialize on a mutex and publish with release stores. Unlinked
+ * nodes are collected under the writer lock and freed in batches of
+ * RECLAIM_BATCH, after one grace period per batch that the writer waits
+ * for outside the lock.
+ */
+
+/* struct for list nodes */
+template<typename T>
+struct node {
+	T						value;
+	std::atomic<node<T>*>	next{nullptr};
+};
+
+/* concurrent sorted singly-linked list */
+template<typename T, typename Alloc = heap_allocator>
+class sorted_list {
+	static const std::size_t RECLAIM_BATCH = 64;
+
+	std::atomic<node<T>*>	first{nullptr};
+	std::mutex				mutex;
+	std::vector<node<T>*>	retired;
+	rcu_domain				rcu;
+
+	/* free a detached chain of nodes in one pass */
+	static void free_chain(node<T>* current) {
+		while(current != nullptr) {
+			node<T>* next = current->next.load(std::memory_order_relaxed);
+			Alloc::deallocate(current);
+			current = next;
+		}
+	}
+
+	/* mutex must be held; releases it. Frees the batch of unlinked nodes once
+	 * it is full and no reader can hold a reference any more.
+	 */
+	void unlock_and_reclaim() {
+		if(retired.size() < RECLAIM_BATCH) {
+			mutex.unlock();
+			return;
+		}
+		std::vector<node<T>*> batch;
+		batch.swap(retired);
+		mutex.unlock();
+		rcu.synchronize();
+		for(auto n : batch) {
+			Alloc::deallocate(n);
+		}
+	}
+
+public:
+	sorted_list() = default;
+	sorted_list(const sorted_list&) = delete;
+	sorted_list& operator=(const sorted_list&) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * nodes are allocated in list order, so neighbours tend to be adjacent
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		std::atomic<node<T>*>* link = &first;
+		for(auto& v : values) {
+			node<T>* current = Alloc::template allocate<node<T>>();
+			current->value = v;
+			link->store(current, std::memory_order_relaxed);
+			link = &current->next;
+		}
+	}
+	~sorted_list() {
+		/* no concurrent users left: free the chain directly */
+		free_chain(first.load());
+		for(auto n : retired) {
+			Alloc::deallocate(n);
+		}
+	}
+
+	/* remove all elements: detach the chain under the writer lock, wait for
+	 * the readers that may still walk it, then free it in one pass
+	 */
+	void clear() {
+		mutex.lock();
+		node<T>* chain = first.load(std::memory_order_relaxed);
+		first.store(nullptr, std::memory_order_release);
+		mutex.unlock();
+		if(chain != nullptr) {
+			rcu.synchronize();
+			free_chain(chain);
+		}
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		/* construct new node */
+		node<T>* current = Alloc::template allocate<node<T>>();
+		current->value = v;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		/* first find position */
+		std::atomic<node<T>*>* link = &first;
+		node<T>* succ = link->load(std::memory_order_relaxed);
+		while(succ != nullptr && succ->value < v) {
+			link = &succ->next;
+			succ = link->load(std::memory_order_relaxed);
+		}
+
+		/* insert new node in front of succ */
+		current->next.store(succ, std::memory_order_relaxed);
+		link->store(current, std::memory_order_release);
+	}
+
+	void remove(T v) {
+		mutex.lock();
+		/* first find position */
+		std::atomic<node<T>*>* link = &first;
+		node<T>* current = link->load(std::memory_order_relaxed);
+		while(current != nullptr && current->value < v) {
+			link = &current->next;
+			current = link->load(std::memory_order_relaxed);
+		}
+		if(current == nullptr || current->value != v) {
+			/* v not found */
+			mutex.unlock();
+			return;
+		}
+		/* unlink; readers already on current still find its successor */
+		link->store(current->next.load(std::memory_order_relaxed), std::memory_order_release);
+		retired.push_back(current);
+		unlock_and_reclaim();
+	}
+
+	/* count elements with value v in the list, without taking any lock */
+	std::size_t count(T v) {
+		rcu_guard guard(rcu);
+		std::size_t cnt = 0;
+		/* first go to value v */
+		node<T>* current = first.load(std::memory_order_acquire);
+		while(current != nullptr && current->value < v) {
+			current = current->next.load(std::memory_order_acquire);
+		}
+		/* count elements */
+		while(current != nullptr && current->value == v) {
+			cnt++;
+			current = current->next.load(std::memory_order_acquire);
+		}
+		return cnt;
+	}
+
+	/* call fn on every element with lo <= value < hi, in order. A lock-free
+	 * walk could mix states before and after a concurrent update, so range
+	 * queries hold the writer lock to stay linearizable.
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		std::lock_guard<std::mutex> lock(mutex);
+		node<T>* current = first.load(std::memory_order_relaxed);
+		while(current != nullptr && current->value < lo) {
+			current = current->next.load(std::memory_order_relaxed);
+		}
+		while(current != nullptr && current->value < hi) {
+			fn(current->value);
+			current = current->next.load(std::memory_order_relaxed);
+		}
+	}
+
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> out;
+		for_each_in_range(lo, hi, [&out](const T& v) { out.push_back(v); });
+		return out;
+	}
+};
+
+#endif // lacpp_sl_hpp_15
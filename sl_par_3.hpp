@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <thread>
+#include <vector>
+#include "node_pool.hpp"
 #ifndef lacpp_sorted_list_hpp
 #define lacpp_sorted_list_hpp lacpp_sorted_list_hpp
 
@@ -9,7 +12,7 @@
  */
 
 struct tatas_lock {
-	std::atomic_bool state;
+	std::atomic_bool state{false};
 
 public:
 	void lock() {
@@ -36,31 +39,60 @@ struct node {
 };
 
 /* non-concurrent sorted singly-linked list */
-template<typename T>
+template<typename T, typename Alloc = heap_allocator>
 class sorted_list {
 	node<T>*	first = nullptr;
 	tatas_lock	mutex;
 
+	/* free a detached chain of nodes in one pass */
+	static void free_chain(node<T>* current) {
+		while(current != nullptr) {
+			node<T>* next = current->next;
+			Alloc::deallocate(current);
+			current = next;
+		}
+	}
+
 	public:
-		/* default implementations:
-		 * default constructor
-		 * copy constructor (note: shallow copy)
-		 * move constructor
-		 * copy assignment operator (note: shallow copy)
-		 * move assignment operator
-		 *
-		 * The first is required due to the others,
-		 * which are explicitly listed due to the rule of five.
+		/* default constructor only; copying and moving are deleted, since
+		 * a member-wise copy would alias the nodes and free them twice
+		 * (see sl_par_14.hpp for a list with O(1) copies and snapshots)
 		 */
 		sorted_list() = default;
-		sorted_list(const sorted_list<T>& other) = default;
-		sorted_list(sorted_list<T>&& other) = default;
-		sorted_list<T>& operator=(const sorted_list<T>& other) = default;
-		sorted_list<T>& operator=(sorted_list<T>&& other) = default;
-		~sorted_list() {
-			while(first != nullptr) {
-				remove(first->value);
+		sorted_list(const sorted_list& other) = delete;
+		sorted_list(sorted_list&& other) = delete;
+		sorted_list& operator=(const sorted_list& other) = delete;
+		sorted_list& operator=(sorted_list&& other) = delete;
+
+		/* build from the values in [begin, end), sorted or not, in O(n log n);
+		 * nodes are allocated in list order, so neighbours tend to be adjacent
+		 */
+		template<typename InputIt>
+		sorted_list(InputIt begin, InputIt end) {
+			std::vector<T> values(begin, end);
+			std::sort(values.begin(), values.end());
+			node<T>** link = &first;
+			for(auto& v : values) {
+				node<T>* current = Alloc::template allocate<node<T>>();
+				current->value = v;
+				*link = current;
+				link = &current->next;
 			}
+			*link = nullptr;
+		}
+		~sorted_list() {
+			free_chain(first);
+		}
+
+		/* remove all elements; the chain is detached under the lock and freed
+		 * after releasing it
+		 */
+		void clear() {
+			mutex.lock();
+			node<T>* chain = first;
+			first = nullptr;
+			mutex.unlock();
+			free_chain(chain);
 		}
 		/* insert v into the list */
 		void insert(T v) {
@@ -75,7 +107,7 @@ class sorted_list {
 			}
 			
 			/* construct new node */
-			node<T>* current = new node<T>();
+			node<T>* current = Alloc::template allocate<node<T>>();
 			current->value = v;
 
 			/* insert new node between pred and succ */
@@ -109,7 +141,7 @@ class sorted_list {
 				pred->next = current->next;
 			}
 			mutex.unlock();
-			delete current;
+			Alloc::deallocate(current);
 		}
 
 		/* count elements with value v in the list */
@@ -129,6 +161,127 @@ class sorted_list {
 			mutex.unlock();
 			return cnt;
 		}
+
+		/* insert all n values of vs under one lock acquisition, in a single
+		 * merge pass over the list
+		 */
+		void insert_many(const T* vs, std::size_t n) {
+			std::vector<T> sorted(vs, vs + n);
+			std::sort(sorted.begin(), sorted.end());
+			mutex.lock();
+			node<T>* pred = nullptr;
+			node<T>* succ = first;
+			for(auto& v : sorted) {
+				while(succ != nullptr && succ->value < v) {
+					pred = succ;
+					succ = succ->next;
+				}
+				/* insert new node between pred and succ, it becomes the new pred */
+				node<T>* current = Alloc::template allocate<node<T>>();
+				current->value = v;
+				current->next = succ;
+				if(pred == nullptr) {
+					first = current;
+				} else {
+					pred->next = current;
+				}
+				pred = current;
+			}
+			mutex.unlock();
+		}
+
+		/* remove one copy of each of the n values of vs under one lock
+		 * acquisition; the removed nodes are freed after releasing it
+		 */
+		void remove_many(const T* vs, std::size_t n) {
+			std::vector<T> sorted(vs, vs + n);
+			std::sort(sorted.begin(), sorted.end());
+			node<T>* removed = nullptr;
+			mutex.lock();
+			node<T>* pred = nullptr;
+			node<T>* current = first;
+			for(auto& v : sorted) {
+				while(current != nullptr && current->value < v) {
+					pred = current;
+					current = current->next;
+				}
+				if(current == nullptr || current->value != v) {
+					/* v not found */
+					continue;
+				}
+				/* unlink current and keep it for freeing */
+				node<T>* next = current->next;
+				if(pred == nullptr) {
+					first = next;
+				} else {
+					pred->next = next;
+				}
+				current->next = removed;
+				removed = current;
+				current = next;
+			}
+			mutex.unlock();
+			free_chain(removed);
+		}
+
+		/* out[i] = count(vs[i]) for all n values of vs, under one lock acquisition */
+		void count_many(const T* vs, std::size_t n, std::size_t* out) {
+			std::vector<std::size_t> order(n);
+			for(std::size_t i = 0; i < n; i++) {
+				order[i] = i;
+			}
+			std::sort(order.begin(), order.end(), [vs](std::size_t a, std::size_t b) { return vs[a] < vs[b]; });
+			mutex.lock();
+			node<T>* current = first;
+			std::size_t cnt = 0;
+			for(std::size_t k = 0; k < n; k++) {
+				T v = vs[order[k]];
+				if(k == 0 || vs[order[k - 1]] < v) {
+					/* new value: go to it and count elements */
+					while(current != nullptr && current->value < v) {
+						current = current->next;
+					}
+					cnt = 0;
+					while(current != nullptr && current->value == v) {
+						cnt++;
+						current = current->next;
+					}
+				}
+				out[order[k]] = cnt;
+			}
+			mutex.unlock();
+		}
+
+		/* call fn(value) for each element with lo <= value < hi, in order;
+		 * fn must not call back into the list
+		 */
+		template<typename F>
+		void for_each_in_range(T lo, T hi, F fn) {
+			mutex.lock();
+			node<T>* current = first;
+			while(current != nullptr && current->value < lo) {
+				current = current->next;
+			}
+			while(current != nullptr && current->value < hi) {
+				fn(current->value);
+				current = current->next;
+			}
+			mutex.unlock();
+		}
+
+		/* count elements with lo <= value < hi */
+		std::size_t count_range(T lo, T hi) {
+			std::size_t cnt = 0;
+			for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+			return cnt;
+		}
+
+		/* the elements with lo <= value < hi, in order, as of one point in time */
+		std::vector<T> snapshot_range(T lo, T hi) {
+			std::vector<T> values;
+			for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+			return values;
+		}
 };
 
 #endif // lacpp_sorted_list_hpp
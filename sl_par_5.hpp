@@ -1,181 +1,91 @@
+#include <algorithm>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <mutex>
 #include <thread>
+#include <vector>
+#include "locks.hpp"
+#include "node_pool.hpp"
 #ifndef lacpp_sl_hpp_5
 #define lacpp_sl_hpp_5 lacpp_sl_hpp_5
 
-#ifndef __clh_lock
-
-#define __clh_lock __clh_lock
-#define CACHELINE_SIZE 64
-
-#include <atomic>
-#include <thread>
-
-class mcs_mutex {
-private:
-    struct mcs_node_t {
-        std::atomic<mcs_node_t*>	next{nullptr};
-        std::atomic<bool>			locked{false};
-    };
-
-    std::atomic<mcs_node_t*> tail{nullptr};
-
-    static thread_local mcs_node_t* local;
-
-public:
-    mcs_mutex() = default;
-
-    void lock() {
-        mcs_node_t* node = local;
-        if (!node) {
-            node = new mcs_node_t();
-            local = node;
-        }
-
-        mcs_node_t* predecessor = tail.exchange(node, std::memory_order_acq_rel);
-
-        if (predecessor != nullptr) {
-            node->locked.store(true, std::memory_order_relaxed);
-            predecessor->next.store(node, std::memory_order_release);
-
-            while (node->locked.load(std::memory_order_acquire)) {
-                std::this_thread::yield();
-            }
-        }
-    }
-
-    void unlock() {
-        mcs_node_t* node = local;
-
-        if (node->next.load(std::memory_order_relaxed) == nullptr) {
-            mcs_node_t* expected = node;
-            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
-                return;
-            }
-
-            while (node->next.load(std::memory_order_acquire) == nullptr) {
-                std::this_thread::yield();
-            }
-        }
-
-        node->next.load(std::memory_order_relaxed)->locked.store(false, std::memory_order_release);
-        node->next.store(nullptr, std::memory_order_relaxed);
-    }
-
-    ~mcs_mutex() {
-        mcs_node_t* last = tail.load(std::memory_order_relaxed);
-        if (last) {
-            delete last;
-        }
-    }
-
-    mcs_mutex(const mcs_mutex&) = delete;
-    mcs_mutex& operator=(const mcs_mutex&) = delete;
-    mcs_mutex(mcs_mutex&&) = delete;
-    mcs_mutex& operator=(mcs_mutex&&) = delete;
-};
-
-thread_local mcs_mutex::mcs_node_t* mcs_mutex::local = nullptr;
-
-/*inline static void cpu_relax() */ 
-/*{ */
-/*    /1* asm volatile("pause\n": : :"memory"); *1/ */
-/*    std::this_thread::yield(); */
-/*} */
-
-/*struct alignas(CACHELINE_SIZE) qnode_t */ 
-/*{ */
-/*	std::atomic_bool	locked; */
-
-/*public: */
-/*	qnode_t()			: locked(false) {} */
-/*	qnode_t(bool init)	: locked(init) {} */
-
-/*}; */
-/*/1* static_assert(sizeof(qnode_t) == CACHELINE_SIZE, "[error] expected node to take up one cache line."); *1/ */
-
-/*/1** */
-/* * @brief The Craig-Landin-Hagersten (CLH) Lock is due to Travis Craig, Erik Hagersten, and Anders Landin[2,3] and like the Anderson Lock it uses the queue lock strategy, however, unlike the bounded queue of Anderson it uses an unbounded and, interestingly, implicit linked list of synchronisation variables. Being queue based it also offer the guarantees of first-come-first-served fairness and no thread starvation. */
-/* * */
-/* * [2] T. Craig. Building FIFO and priority-queueing spin locks from atomic swap. Technical Report TR 93-02-02, University of Washington, Department of Computer Science, February 1993. */
-/* * [3] P. Magnussen, A. Landin, and E. Hagersten. Queue locks on cache coherent multiprocessors. In Proc. of the Eighth International Symposium on Parallel Processing (IPPS), pp. 165– 171, April 1994. IEEE Computer Society, April 1994. Vancouver */
-/* *1/ */
-/*class clh_mutex { */
-
-/*    // neat cacheline padding trick by  David Geier geidav.wordpress.com */
-/*    // cacheline padding is essential to avoid false sharing */
-/*    using node_t = std::pair<bool, uint8_t[CACHELINE_SIZE - sizeof(bool)]>; */
-
-/*    static_assert(sizeof(node_t) == CACHELINE_SIZE, ""); */
-
-/*public: */
-
-/*    clh_mutex() : tail(new node_t{}) {} */
-
-/*    void lock() { */
-/*        local_node->first = true; */
-/*        prior_node = tail.exchange(local_node.get()); */
-/*        while (prior_node->first) { */
-/*            cpu_relax(); */
-/*        } */
-/*    } */
-
-/*    void unlock() { */
-/*        local_node->first = false; */
-/*        node_t* tmp = prior_node; */
-/*        prior_node = local_node.release(); */
-/*        local_node.reset(tmp); */
-/*    } */
-
-/*    ~clh_mutex() { */
-/*        delete tail.load(); */
-/*    } */
-
-/*private: */
-
-/*    std::atomic<node_t*> tail; */
-
-/*    static thread_local std::unique_ptr<node_t> local_node; */
-/*    static thread_local node_t* prior_node; */
-
-/*}; */
+/* MCS queue lock, see locks.hpp; every acquisition brings its own qnode,
+ * so holding two node locks during hand-over-hand is fine
+ */
+using lacpp::mcs_mutex;
 
 /* struct for list nodes */
 template<typename T>
-struct node {
+struct alignas(CACHELINE_SIZE) node {
 	T			value;
 	node<T>*	next;
 	mcs_mutex	mutex;
 };
 
 /* non-concurrent sorted singly-linked list */
-template<typename T>
+template<typename T, typename Alloc = heap_allocator>
 class sorted_list {
 	node<T>*	head = nullptr;
 	mcs_mutex	head_mutex;
 
+	/* free a detached chain of nodes in one pass */
+	static void free_chain(node<T>* current) {
+		while(current != nullptr) {
+			node<T>* next = current->next;
+			Alloc::deallocate(current);
+			current = next;
+		}
+	}
+
 public:
-	/* default implementations:
-	 * default constructor
-	 * copy constructor (note: shallow copy)
-	 * move constructor
-	 * copy assignment operator (note: shallow copy)
-	 * move assignment operator
-	 *
-	 * The first is required due to the others,
-	 * which are explicitly listed due to the rule of five.
+	/* default constructor only; copying and moving are deleted, since
+	 * a member-wise copy would alias the nodes and free them twice
+	 * (see sl_par_14.hpp for a list with O(1) copies and snapshots)
 	 */
 	sorted_list() = default;
-	sorted_list(const sorted_list<T>& other) = default;
-	sorted_list(sorted_list<T>&& other) = default;
-	sorted_list<T>& operator=(const sorted_list<T>& other) = default;
-	sorted_list<T>& operator=(sorted_list<T>&& other) = default;
+	sorted_list(const sorted_list& other) = delete;
+	sorted_list(sorted_list&& other) = delete;
+	sorted_list& operator=(const sorted_list& other) = delete;
+	sorted_list& operator=(sorted_list&& other) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * nodes are allocated in list order, so neighbours tend to be adjacent
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		node<T>** link = &head;
+		for(auto& v : values) {
+			node<T>* current = Alloc::template allocate<node<T>>();
+			current->value = v;
+			*link = current;
+			link = &current->next;
+		}
+		*link = nullptr;
+	}
 	~sorted_list() {
-		while(head != nullptr) {
-			remove(head->value);
+		free_chain(head);
+	}
+
+	/* remove all elements in one pass: detach the chain under the head lock,
+	 * then follow it hand-over-hand, so threads still working in it stay
+	 * ahead of us and every node is freed once they have left it
+	 */
+	void clear() {
+		head_mutex.lock();
+		node<T>* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+		head = nullptr;
+		head_mutex.unlock();
+
+		while(curr != nullptr) {
+			node<T>* next = curr->next;
+			if (next != nullptr) next->mutex.lock();
+			curr->mutex.unlock();
+			Alloc::deallocate(curr);
+			curr = next;
 		}
 	}
 
@@ -194,7 +104,7 @@ public:
 		}
 		
 		/* construct new node */
-		node<T>* new_node = new node<T>();
+		node<T>* new_node = Alloc::template allocate<node<T>>();
 		new_node->value = v;
 
 		/* insert new node between pred and succ */
@@ -241,7 +151,7 @@ public:
 		}
 
 		curr->mutex.unlock();
-		delete curr;
+		Alloc::deallocate(curr);
 	}
 
 	/* count elements with value v in the list */
@@ -269,7 +179,178 @@ public:
 
 		return cnt;
 	};
+
+	/* insert all n values of vs in a single hand-over-hand pass */
+	void insert_many(const T* vs, std::size_t n) {
+		std::vector<T> sorted(vs, vs + n);
+		std::sort(sorted.begin(), sorted.end());
+
+		head_mutex.lock();
+		node<T>* pred = nullptr;
+		/* last node before succ: pred itself or a node linked in by this call,
+		 * which nobody else can reach while we hold pred
+		 */
+		node<T>* last = nullptr;
+		node<T>* succ = head;
+		if (succ != nullptr) succ->mutex.lock();
+
+		for(auto& v : sorted) {
+			while(succ != nullptr && succ->value < v) {
+				if (pred == nullptr) head_mutex.unlock();
+				else pred->mutex.unlock();
+				pred = succ;
+				last = succ;
+				if (succ->next != nullptr) succ->next->mutex.lock();
+				succ = succ->next;
+			}
+
+			/* insert new node between last and succ */
+			node<T>* new_node = Alloc::template allocate<node<T>>();
+			new_node->value = v;
+			new_node->next = succ;
+			if(last == nullptr) {
+				head = new_node;
+			} else {
+				last->next = new_node;
+			}
+			last = new_node;
+		}
+
+		if (pred != nullptr) pred->mutex.unlock();
+		else head_mutex.unlock();
+		if (succ != nullptr) succ->mutex.unlock();
+	}
+
+	/* remove one copy of each of the n values of vs in a single hand-over-hand pass */
+	void remove_many(const T* vs, std::size_t n) {
+		std::vector<T> sorted(vs, vs + n);
+		std::sort(sorted.begin(), sorted.end());
+
+		head_mutex.lock();
+		node<T>* pred = nullptr;
+		node<T>* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+
+		for(auto& v : sorted) {
+			while(curr != nullptr && curr->value < v) {
+				if (pred == nullptr) head_mutex.unlock();
+				else pred->mutex.unlock();
+				pred = curr;
+				if (curr->next != nullptr) curr->next->mutex.lock();
+				curr = curr->next;
+			}
+			if(curr == nullptr || curr->value != v) {
+				/* v not found */
+				continue;
+			}
+
+			/* unlink curr, pred stays locked and its new successor gets locked */
+			node<T>* next = curr->next;
+			if (next != nullptr) next->mutex.lock();
+			if(pred == nullptr) head = next;
+			else pred->next = next;
+			curr->mutex.unlock();
+			Alloc::deallocate(curr);
+			curr = next;
+		}
+
+		if (pred != nullptr) pred->mutex.unlock();
+		else head_mutex.unlock();
+		if (curr != nullptr) curr->mutex.unlock();
+	}
+
+	/* out[i] = count(vs[i]) for all n values of vs, in a single hand-over-hand pass */
+	void count_many(const T* vs, std::size_t n, std::size_t* out) {
+		std::vector<std::size_t> order(n);
+		for(std::size_t i = 0; i < n; i++) {
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [vs](std::size_t a, std::size_t b) { return vs[a] < vs[b]; });
+
+		std::unique_lock<mcs_mutex> head_lock(head_mutex);
+		node<T>* curr = head;
+		std::size_t cnt = 0;
+
+		for(std::size_t k = 0; k < n; k++) {
+			T v = vs[order[k]];
+			if(k > 0 && !(vs[order[k - 1]] < v)) {
+				/* same value as before */
+				out[order[k]] = cnt;
+				continue;
+			}
+			while(curr != nullptr && curr->value < v) {
+				std::unique_lock<mcs_mutex> curr_lock(curr->mutex);
+				head_lock.unlock();
+				curr = curr->next;
+				head_lock = std::move(curr_lock);
+			}
+
+			/* count elements */
+			cnt = 0;
+			while(curr != nullptr && curr->value == v) {
+				std::unique_lock<mcs_mutex> curr_lock(curr->mutex);
+				cnt++;
+				node<T>* next = curr->next;
+				head_lock.unlock();
+				curr = next;
+				head_lock = std::move(curr_lock);
+			}
+			out[order[k]] = cnt;
+		}
+	}
+
+	/* call fn(value) for each element with lo <= value < hi, in order, as one
+	 * atomic step: every node of the range stays locked until the end, so
+	 * the values seen are the state at the moment the last one was locked.
+	 * fn runs under the node locks and must not call back into the list.
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		head_mutex.lock();
+		node<T>* pred = nullptr;
+		node<T>* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+
+		while(curr != nullptr && curr->value < lo) {
+			if (pred == nullptr) head_mutex.unlock();
+			else pred->mutex.unlock();
+			pred = curr;
+			if (curr->next != nullptr) curr->next->mutex.lock();
+			curr = curr->next;
+		}
+
+		/* pred and curr are locked: lock the rest of the range without releasing */
+		node<T>* first = curr;
+		while(curr != nullptr && curr->value < hi) {
+			fn(curr->value);
+			if (curr->next != nullptr) curr->next->mutex.lock();
+			curr = curr->next;
+		}
+
+		/* release pred, the range and the node after it */
+		if (pred == nullptr) head_mutex.unlock();
+		else pred->mutex.unlock();
+		while(first != curr) {
+			node<T>* next = first->next;
+			first->mutex.unlock();
+			first = next;
+		}
+		if (curr != nullptr) curr->mutex.unlock();
+	}
+
+	/* count elements with lo <= value < hi */
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	/* the elements with lo <= value < hi, in order, as of one point in time */
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> values;
+		for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+		return values;
+	}
 };
 
 #endif // lacpp_sl_hpp_5
-#endif // !__clh_lock
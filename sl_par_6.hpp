@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "epoch.hpp"
+#ifndef lacpp_sl_hpp_6
+#define lacpp_sl_hpp_6 lacpp_sl_hpp_6
+
+/* lock-free sorted list after Harris (2001) and Michael (2002)
+ *
+ * A node is deleted by first setting the low bit of its next pointer
+ * (logical deletion), then swinging its predecessor past it. Traversals
+ * help unlink marked nodes they meet; unlinked nodes are freed through
+ * epoch-based reclamation.
+ */
+
+/* struct for list nodes */
+template<typename T>
+struct node {
+	T						value;
+	std::atomic<node<T>*>	next;
+};
+
+template<typename T>
+inline bool is_marked(node<T>* p) {
+	return reinterpret_cast<std::uintptr_t>(p) & 1;
+}
+
+template<typename T>
+inline node<T>* marked(node<T>* p) {
+	return reinterpret_cast<node<T>*>(reinterpret_cast<std::uintptr_t>(p) | 1);
+}
+
+template<typename T>
+inline node<T>* unmarked(node<T>* p) {
+	return reinterpret_cast<node<T>*>(reinterpret_cast<std::uintptr_t>(p) & ~std::uintptr_t(1));
+}
+
+/* lock-free sorted singly-linked list */
+template<typename T>
+class sorted_list {
+	std::atomic<node<T>*>	head{nullptr};
+	epoch_domain			epoch;
+
+	/* find the first unmarked node with value >= v and the link pointing to it,
+	 * unlinking marked nodes on the way; caller must hold an epoch_guard
+	 */
+	void find(T v, std::atomic<node<T>*>*& prev, node<T>*& curr) {
+	retry:
+		prev = &head;
+		curr = prev->load();
+		while(curr != nullptr) {
+			node<T>* next = curr->next.load();
+			if(is_marked(next)) {
+				node<T>* expected = curr;
+				if(!prev->compare_exchange_strong(expected, unmarked(next))) {
+					goto retry;
+				}
+				epoch.retire(curr);
+				curr = unmarked(next);
+				continue;
+			}
+			if(!(curr->value < v)) {
+				return;
+			}
+			prev = &curr->next;
+			curr = next;
+		}
+	}
+
+	/* unlink every marked node, as find() does on its way; caller must hold
+	 * an epoch_guard
+	 */
+	void unlink_marked() {
+	retry:
+		std::atomic<node<T>*>* prev = &head;
+		node<T>* curr = prev->load();
+		while(curr != nullptr) {
+			node<T>* next = curr->next.load();
+			if(is_marked(next)) {
+				node<T>* expected = curr;
+				if(!prev->compare_exchange_strong(expected, unmarked(next))) {
+					goto retry;
+				}
+				epoch.retire(curr);
+				curr = unmarked(next);
+				continue;
+			}
+			prev = &curr->next;
+			curr = next;
+		}
+	}
+
+public:
+	/* default constructor only; copying and moving are deleted, since
+	 * a member-wise copy would alias the nodes and free them twice
+	 * (see sl_par_14.hpp for a list with O(1) copies and snapshots)
+	 */
+	sorted_list() = default;
+	sorted_list(const sorted_list<T>& other) = delete;
+	sorted_list(sorted_list<T>&& other) = delete;
+	sorted_list<T>& operator=(const sorted_list<T>& other) = delete;
+	sorted_list<T>& operator=(sorted_list<T>&& other) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * nodes are allocated in list order, so neighbours tend to be adjacent
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		std::atomic<node<T>*>* link = &head;
+		for(auto& v : values) {
+			node<T>* current = new node<T>();
+			current->value = v;
+			link->store(current, std::memory_order_relaxed);
+			link = &current->next;
+		}
+		link->store(nullptr, std::memory_order_relaxed);
+	}
+	~sorted_list() {
+		/* no concurrent users left: free the chain directly */
+		node<T>* curr = head.load();
+		while(curr != nullptr) {
+			node<T>* next = unmarked(curr->next.load());
+			delete curr;
+			curr = next;
+		}
+	}
+
+	/* remove all elements in one pass: mark every node front to back, then
+	 * unlink the marked nodes. Like a series of removes, this is not one
+	 * atomic step; values inserted behind the marking pass stay.
+	 */
+	void clear() {
+		epoch_guard guard(epoch);
+		node<T>* curr = head.load();
+		while(curr != nullptr) {
+			node<T>* next = curr->next.load();
+			while(!is_marked(next) && !curr->next.compare_exchange_weak(next, marked(next))) {
+			}
+			curr = unmarked(next);
+		}
+		unlink_marked();
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		node<T>* new_node = new node<T>();
+		new_node->value = v;
+
+		epoch_guard guard(epoch);
+		while(true) {
+			std::atomic<node<T>*>* prev;
+			node<T>* curr;
+			find(v, prev, curr);
+			new_node->next.store(curr, std::memory_order_relaxed);
+			if(prev->compare_exchange_strong(curr, new_node)) {
+				return;
+			}
+		}
+	}
+
+	void remove(T v) {
+		epoch_guard guard(epoch);
+		while(true) {
+			std::atomic<node<T>*>* prev;
+			node<T>* curr;
+			find(v, prev, curr);
+			if(curr == nullptr || curr->value != v) {
+				/* v not found */
+				return;
+			}
+			node<T>* next = curr->next.load();
+			if(is_marked(next)) {
+				continue;
+			}
+			/* logical deletion */
+			if(!curr->next.compare_exchange_strong(next, marked(next))) {
+				continue;
+			}
+			/* physical deletion, or leave it to the next traversal */
+			node<T>* expected = curr;
+			if(prev->compare_exchange_strong(expected, next)) {
+				epoch.retire(curr);
+			} else {
+				find(v, prev, curr);
+			}
+			return;
+		}
+	}
+
+	/* count elements with value v in the list */
+	std::size_t count(T v) {
+		epoch_guard guard(epoch);
+		std::size_t cnt = 0;
+		/* first go to value v */
+		node<T>* curr = head.load();
+		while(curr != nullptr && curr->value < v) {
+			curr = unmarked(curr->next.load());
+		}
+		/* count elements that are not logically deleted */
+		while(curr != nullptr && curr->value == v) {
+			node<T>* next = curr->next.load();
+			if(!is_marked(next)) {
+				cnt++;
+			}
+			curr = unmarked(next);
+		}
+		return cnt;
+	}
+};
+
+#endif // lacpp_sl_hpp_6
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "epoch.hpp"
+#include "fingers.hpp"
+#ifndef lacpp_sl_hpp_7
+#define lacpp_sl_hpp_7 lacpp_sl_hpp_7
+
+/* lazy sorted list after Heller et al. (2005)
+ *
+ * Writers traverse without locks, then lock only pred (and curr for
+ * removal) and validate that neither is deleted and pred still points to
+ * curr. Removal sets the marked flag before unlinking, so count() can
+ * walk the list without any locks and skip marked nodes. The only store
+ * count() makes is the epoch announcement in its own per-thread slot.
+ *
+ * With Fingers > 0, every thread keeps that many search fingers (see
+ * fingers.hpp): an operation starts at the closest remembered node below
+ * its key that is still unmarked, instead of at the head, and remembers
+ * the pred it ends at. For clustered key streams a search then costs the
+ * distance to the previous key rather than the length of the list.
+ */
+
+/* struct for list nodes */
+template<typename T>
+struct node {
+	T						value;
+	std::atomic<node<T>*>	next{nullptr};
+	std::atomic<bool>		marked{false};
+	std::mutex				mutex;
+};
+
+/* lazy sorted singly-linked list */
+template<typename T, std::size_t Fingers = 0>
+class sorted_list {
+	/* sentinel, its value is never looked at */
+	node<T>			head;
+	epoch_domain	epoch;
+	finger_cache<node<T>, Fingers>	fingers;
+
+	/* closest unmarked finger below v, or the sentinel; slot gets its index */
+	node<T>* start(T v, int& slot) {
+		node<T>* finger = fingers.find(epoch,
+			[v](node<T>* n) { return n->value < v && !n->marked.load(); },
+			[](node<T>* a, node<T>* b) { return b->value < a->value; },
+			slot);
+		return finger != nullptr ? finger : &head;
+	}
+
+	/* pred ended a search; must be inside the epoch guard */
+	void remember(node<T>* pred, int slot) {
+		if(pred != &head) {
+			fingers.remember(epoch, pred, slot);
+		}
+	}
+
+	/* find pred, curr with pred->value < v <= curr->value without locking,
+	 * starting from the closest finger; slot gets the finger used
+	 */
+	void find(T v, node<T>*& pred, node<T>*& curr, int& slot) {
+		pred = start(v, slot);
+		curr = pred->next.load();
+		while(curr != nullptr && curr->value < v) {
+			pred = curr;
+			curr = curr->next.load();
+		}
+	}
+
+	/* pred and curr are still adjacent and live; both must be locked */
+	static bool validate(node<T>* pred, node<T>* curr) {
+		return !pred->marked.load()
+			&& (curr == nullptr || !curr->marked.load())
+			&& pred->next.load() == curr;
+	}
+
+public:
+	/* default constructor only; copying and moving are deleted, since
+	 * a member-wise copy would alias the nodes and free them twice
+	 * (see sl_par_14.hpp for a list with O(1) copies and snapshots)
+	 */
+	sorted_list() = default;
+	sorted_list(const sorted_list& other) = delete;
+	sorted_list(sorted_list&& other) = delete;
+	sorted_list& operator=(const sorted_list& other) = delete;
+	sorted_list& operator=(sorted_list&& other) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * nodes are allocated in list order, so neighbours tend to be adjacent
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		std::atomic<node<T>*>* link = &head.next;
+		for(auto& v : values) {
+			node<T>* current = new node<T>();
+			current->value = v;
+			link->store(current, std::memory_order_relaxed);
+			link = &current->next;
+		}
+		link->store(nullptr, std::memory_order_relaxed);
+	}
+	~sorted_list() {
+		/* no concurrent users left: free the chain directly */
+		node<T>* curr = head.next.load();
+		while(curr != nullptr) {
+			node<T>* next = curr->next.load();
+			delete curr;
+			curr = next;
+		}
+	}
+
+	/* remove all elements as one atomic step: lock the sentinel and then
+	 * every node front to back (the order writers lock in), mark them all and
+	 * cut the chain off the sentinel. Readers skip marked nodes and writers
+	 * fail validation on them, so nodes are retired rather than freed.
+	 */
+	void clear() {
+		epoch_guard guard(epoch);
+		head.mutex.lock();
+		node<T>* first = head.next.load();
+		for(node<T>* curr = first; curr != nullptr; curr = curr->next.load()) {
+			curr->mutex.lock();
+			curr->marked.store(true);
+		}
+		head.next.store(nullptr);
+		head.mutex.unlock();
+		while(first != nullptr) {
+			node<T>* next = first->next.load();
+			first->mutex.unlock();
+			epoch.retire(first);
+			first = next;
+		}
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		/* construct new node */
+		node<T>* new_node = new node<T>();
+		new_node->value = v;
+
+		epoch_guard guard(epoch);
+		while(true) {
+			node<T>* pred;
+			node<T>* curr;
+			int slot;
+			find(v, pred, curr, slot);
+			std::lock_guard<std::mutex> pred_lock(pred->mutex);
+			if(!pred->marked.load() && pred->next.load() == curr) {
+				/* insert new node between pred and curr */
+				new_node->next.store(curr, std::memory_order_relaxed);
+				pred->next.store(new_node);
+				remember(pred, slot);
+				return;
+			}
+		}
+	}
+
+	void remove(T v) {
+		epoch_guard guard(epoch);
+		while(true) {
+			node<T>* pred;
+			node<T>* curr;
+			int slot;
+			find(v, pred, curr, slot);
+			if(curr == nullptr || curr->value != v) {
+				/* v not found */
+				remember(pred, slot);
+				return;
+			}
+			std::lock_guard<std::mutex> pred_lock(pred->mutex);
+			std::lock_guard<std::mutex> curr_lock(curr->mutex);
+			if(validate(pred, curr)) {
+				/* logical, then physical deletion */
+				curr->marked.store(true);
+				pred->next.store(curr->next.load());
+				epoch.retire(curr);
+				remember(pred, slot);
+				return;
+			}
+		}
+	}
+
+	/* count elements with value v in the list, without taking any lock */
+	std::size_t count(T v) {
+		epoch_guard guard(epoch);
+		std::size_t cnt = 0;
+		/* first go to value v */
+		node<T>* pred;
+		node<T>* curr;
+		int slot;
+		find(v, pred, curr, slot);
+		remember(pred, slot);
+		/* count elements that are not logically deleted */
+		while(curr != nullptr && curr->value == v) {
+			if(!curr->marked.load()) {
+				cnt++;
+			}
+			curr = curr->next.load();
+		}
+		return cnt;
+	}
+
+	/* call fn(value) for each element with lo <= value < hi, in order, as one
+	 * atomic step: lock pred and check it is still in the list, then lock
+	 * the nodes of the range front to back (the order writers lock in) and
+	 * keep them locked until the end. Nothing can be linked in or out of the
+	 * range while its preds are held. fn runs under the node locks and must
+	 * not call back into the list.
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		epoch_guard guard(epoch);
+		while(true) {
+			node<T>* pred;
+			node<T>* curr;
+			int slot;
+			find(lo, pred, curr, slot);
+			pred->mutex.lock();
+			if(pred->marked.load()) {
+				pred->mutex.unlock();
+				continue;
+			}
+			/* nodes reached from a locked live pred are live, and stay so */
+			curr = pred->next.load();
+			while(curr != nullptr && curr->value < hi) {
+				curr->mutex.lock();
+				if(!(curr->value < lo)) {
+					fn(curr->value);
+				}
+				curr = curr->next.load();
+			}
+			remember(pred, slot);
+			for(node<T>* n = pred; n != curr; ) {
+				node<T>* next = n->next.load();
+				n->mutex.unlock();
+				n = next;
+			}
+			return;
+		}
+	}
+
+	/* count elements with lo <= value < hi */
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	/* the elements with lo <= value < hi, in order, as of one point in time */
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> values;
+		for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+		return values;
+	}
+};
+
+#endif // lacpp_sl_hpp_7
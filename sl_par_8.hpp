@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+#include "thread_index.hpp"
+#ifndef lacpp_sl_hpp_8
+#define lacpp_sl_hpp_8 lacpp_sl_hpp_8
+
+/* reader-writer lock with one padded reader counter per slot
+ *
+ * Readers only touch the counter of their own slot, so concurrent count()
+ * calls do not bounce a shared cache line. A writer raises the writer
+ * flag, which turns new readers away, then waits for every slot to drain.
+ */
+class rw_lock {
+	static const std::size_t READER_SLOTS = 64;
+
+	struct alignas(CACHELINE_SIZE) reader_slot {
+		std::atomic<long>	readers{0};
+	};
+
+	alignas(CACHELINE_SIZE) std::atomic_bool writer{false};
+	reader_slot slots[READER_SLOTS];
+
+public:
+	void lock() {
+		while(writer.exchange(true, std::memory_order_seq_cst)) {
+			while(writer.load(std::memory_order_relaxed)) {
+				std::this_thread::yield();
+			}
+		}
+		for(auto& slot : slots) {
+			while(slot.readers.load(std::memory_order_seq_cst) != 0) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void unlock() { writer.store(false, std::memory_order_release); }
+
+	void lock_shared() {
+		reader_slot& slot = slots[thread_index() % READER_SLOTS];
+		while(true) {
+			while(writer.load(std::memory_order_relaxed)) {
+				std::this_thread::yield();
+			}
+			slot.readers.fetch_add(1, std::memory_order_seq_cst);
+			if(!writer.load(std::memory_order_seq_cst)) {
+				return;
+			}
+			/* a writer got in first: back off */
+			slot.readers.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	void unlock_shared() {
+		slots[thread_index() % READER_SLOTS].readers.fetch_sub(1, std::memory_order_release);
+	}
+};
+
+/* struct for list nodes */
+template<typename T>
+struct node {
+	T			value;
+	node<T>*	next;
+};
+
+/* coarse-grained sorted singly-linked list, readers share the lock */
+template<typename T>
+class sorted_list {
+	node<T>*	first = nullptr;
+	rw_lock		mutex;
+
+	/* free a detached chain of nodes in one pass */
+	static void free_chain(node<T>* current) {
+		while(current != nullptr) {
+			node<T>* next = current->next;
+			delete current;
+			current = next;
+		}
+	}
+
+	public:
+		/* default constructor only; copying and moving are deleted, since
+		 * a member-wise copy would alias the nodes and free them twice
+		 * (see sl_par_14.hpp for a list with O(1) copies and snapshots)
+		 */
+		sorted_list() = default;
+		sorted_list(const sorted_list<T>& other) = delete;
+		sorted_list(sorted_list<T>&& other) = delete;
+		sorted_list<T>& operator=(const sorted_list<T>& other) = delete;
+		sorted_list<T>& operator=(sorted_list<T>&& other) = delete;
+
+		/* build from the values in [begin, end), sorted or not, in O(n log n);
+		 * nodes are allocated in list order, so neighbours tend to be adjacent
+		 */
+		template<typename InputIt>
+		sorted_list(InputIt begin, InputIt end) {
+			std::vector<T> values(begin, end);
+			std::sort(values.begin(), values.end());
+			node<T>** link = &first;
+			for(auto& v : values) {
+				node<T>* current = new node<T>();
+				current->value = v;
+				*link = current;
+				link = &current->next;
+			}
+			*link = nullptr;
+		}
+		~sorted_list() {
+			free_chain(first);
+		}
+
+		/* remove all elements; the chain is detached under the lock and freed
+		 * after releasing it
+		 */
+		void clear() {
+			mutex.lock();
+			node<T>* chain = first;
+			first = nullptr;
+			mutex.unlock();
+			free_chain(chain);
+		}
+		/* insert v into the list */
+		void insert(T v) {
+			mutex.lock();
+			/* first find position */
+			node<T>* pred = nullptr;
+			node<T>* succ = first;
+			while(succ != nullptr && succ->value < v) {
+				pred = succ;
+				succ = succ->next;
+			}
+			
+			/* construct new node */
+			node<T>* current = new node<T>();
+			current->value = v;
+
+			/* insert new node between pred and succ */
+			current->next = succ;
+			if(pred == nullptr) {
+				first = current;
+			} else {
+				pred->next = current;
+			}
+			mutex.unlock();
+		}
+
+		void remove(T v) {
+			mutex.lock();
+			/* first find position */
+			node<T>* pred = nullptr;
+			node<T>* current = first;
+			while(current != nullptr && current->value < v) {
+				pred = current;
+				current = current->next;
+			}
+			if(current == nullptr || current->value != v) {
+				/* v not found */
+				mutex.unlock();
+				return;
+			}
+			/* remove current */
+			if(pred == nullptr) {
+				first = current->next;
+			} else {
+				pred->next = current->next;
+			}
+			mutex.unlock();
+			delete current;
+		}
+
+		/* count elements with value v in the list */
+		std::size_t count(T v) {
+			mutex.lock_shared();
+			std::size_t cnt = 0;
+			/* first go to value v */
+			node<T>* current = first;
+			while(current != nullptr && current->value < v) {
+				current = current->next;
+			}
+			/* count elements */
+			while(current != nullptr && current->value == v) {
+				cnt++;
+				current = current->next;
+			}
+			mutex.unlock_shared();
+			return cnt;
+		}
+
+		/* call fn(value) for each element with lo <= value < hi, in order,
+		 * under the read lock; fn must not call back into the list
+		 */
+		template<typename F>
+		void for_each_in_range(T lo, T hi, F fn) {
+			mutex.lock_shared();
+			node<T>* current = first;
+			while(current != nullptr && current->value < lo) {
+				current = current->next;
+			}
+			while(current != nullptr && current->value < hi) {
+				fn(current->value);
+				current = current->next;
+			}
+			mutex.unlock_shared();
+		}
+
+		/* count elements with lo <= value < hi */
+		std::size_t count_range(T lo, T hi) {
+			std::size_t cnt = 0;
+			for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+			return cnt;
+		}
+
+		/* the elements with lo <= value < hi, in order, as of one point in time */
+		std::vector<T> snapshot_range(T lo, T hi) {
+			std::vector<T> values;
+			for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+			return values;
+		}
+};
+
+#endif // lacpp_sl_hpp_8
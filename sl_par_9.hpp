@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "epoch.hpp"
+#include "locks.hpp"
+#ifndef lacpp_sl_hpp_9
+#define lacpp_sl_hpp_9 lacpp_sl_hpp_9
+
+using lacpp::seq_lock;
+
+/* struct for list nodes */
+template<typename T>
+struct node {
+	T						value;
+	std::atomic<node<T>*>	next;
+};
+
+/* coarse-grained sorted singly-linked list with optimistic readers
+ *
+ * Readers may run into nodes a writer is unlinking at the same time, so
+ * removed nodes are retired through the epoch domain rather than deleted.
+ */
+template<typename T>
+class sorted_list {
+	std::atomic<node<T>*>	first{nullptr};
+	seq_lock				mutex;
+	epoch_domain			epoch;
+
+	public:
+		/* default constructor only; copying and moving are deleted, since
+		 * a member-wise copy would alias the nodes and free them twice
+		 * (see sl_par_14.hpp for a list with O(1) copies and snapshots)
+		 */
+		sorted_list() = default;
+		sorted_list(const sorted_list<T>& other) = delete;
+		sorted_list(sorted_list<T>&& other) = delete;
+		sorted_list<T>& operator=(const sorted_list<T>& other) = delete;
+		sorted_list<T>& operator=(sorted_list<T>&& other) = delete;
+
+		/* build from the values in [begin, end), sorted or not, in O(n log n);
+		 * nodes are allocated in list order, so neighbours tend to be adjacent
+		 */
+		template<typename InputIt>
+		sorted_list(InputIt begin, InputIt end) {
+			std::vector<T> values(begin, end);
+			std::sort(values.begin(), values.end());
+			std::atomic<node<T>*>* link = &first;
+			for(auto& v : values) {
+				node<T>* current = new node<T>();
+				current->value = v;
+				link->store(current, std::memory_order_relaxed);
+				link = &current->next;
+			}
+			link->store(nullptr, std::memory_order_relaxed);
+		}
+		~sorted_list() {
+			/* no concurrent users left: free the chain directly */
+			node<T>* current = first.load();
+			while(current != nullptr) {
+				node<T>* next = current->next.load();
+				delete current;
+				current = next;
+			}
+		}
+		/* remove all elements: detach the chain under the writer lock and
+		 * retire its nodes, since readers may still be walking it
+		 */
+		void clear() {
+			epoch_guard guard(epoch);
+			mutex.lock();
+			node<T>* current = first.load(std::memory_order_relaxed);
+			first.store(nullptr, std::memory_order_release);
+			mutex.unlock();
+			while(current != nullptr) {
+				node<T>* next = current->next.load(std::memory_order_relaxed);
+				epoch.retire(current);
+				current = next;
+			}
+		}
+		/* insert v into the list */
+		void insert(T v) {
+			/* construct new node */
+			node<T>* current = new node<T>();
+			current->value = v;
+
+			mutex.lock();
+			/* first find position */
+			node<T>* pred = nullptr;
+			node<T>* succ = first.load(std::memory_order_relaxed);
+			while(succ != nullptr && succ->value < v) {
+				pred = succ;
+				succ = succ->next.load(std::memory_order_relaxed);
+			}
+
+			/* insert new node between pred and succ */
+			current->next.store(succ, std::memory_order_relaxed);
+			if(pred == nullptr) {
+				first.store(current, std::memory_order_release);
+			} else {
+				pred->next.store(current, std::memory_order_release);
+			}
+			mutex.unlock();
+		}
+
+		void remove(T v) {
+			epoch_guard guard(epoch);
+			mutex.lock();
+			/* first find position */
+			node<T>* pred = nullptr;
+			node<T>* current = first.load(std::memory_order_relaxed);
+			while(current != nullptr && current->value < v) {
+				pred = current;
+				current = current->next.load(std::memory_order_relaxed);
+			}
+			if(current == nullptr || current->value != v) {
+				/* v not found */
+				mutex.unlock();
+				return;
+			}
+			/* remove current */
+			node<T>* next = current->next.load(std::memory_order_relaxed);
+			if(pred == nullptr) {
+				first.store(next, std::memory_order_release);
+			} else {
+				pred->next.store(next, std::memory_order_release);
+			}
+			mutex.unlock();
+			epoch.retire(current);
+		}
+
+		/* count elements with value v in the list, retrying if a writer intervened */
+		std::size_t count(T v) {
+			epoch_guard guard(epoch);
+			while(true) {
+				unsigned long s = mutex.read_begin();
+				std::size_t cnt = 0;
+				/* first go to value v */
+				node<T>* current = first.load(std::memory_order_acquire);
+				while(current != nullptr && current->value < v) {
+					current = current->next.load(std::memory_order_acquire);
+				}
+				/* count elements */
+				while(current != nullptr && current->value == v) {
+					cnt++;
+					current = current->next.load(std::memory_order_acquire);
+				}
+				if(!mutex.read_retry(s)) {
+					return cnt;
+				}
+			}
+		}
+
+		/* call fn(value) for each element with lo <= value < hi, in order.
+		 * The values are copied out under the sequence number, retrying if a
+		 * writer intervened, and fn only sees a copy that was consistent.
+		 */
+		template<typename F>
+		void for_each_in_range(T lo, T hi, F fn) {
+			for(auto& v : snapshot_range(lo, hi)) {
+				fn(v);
+			}
+		}
+
+		/* count elements with lo <= value < hi */
+		std::size_t count_range(T lo, T hi) {
+			epoch_guard guard(epoch);
+			while(true) {
+				unsigned long s = mutex.read_begin();
+				std::size_t cnt = 0;
+				node<T>* current = first.load(std::memory_order_acquire);
+				while(current != nullptr && current->value < lo) {
+					current = current->next.load(std::memory_order_acquire);
+				}
+				while(current != nullptr && current->value < hi) {
+					cnt++;
+					current = current->next.load(std::memory_order_acquire);
+				}
+				if(!mutex.read_retry(s)) {
+					return cnt;
+				}
+			}
+		}
+
+		/* the elements with lo <= value < hi, in order, as of one point in time */
+		std::vector<T> snapshot_range(T lo, T hi) {
+			epoch_guard guard(epoch);
+			std::vector<T> values;
+			while(true) {
+				unsigned long s = mutex.read_begin();
+				values.clear();
+				node<T>* current = first.load(std::memory_order_acquire);
+				while(current != nullptr && current->value < lo) {
+					current = current->next.load(std::memory_order_acquire);
+				}
+				while(current != nullptr && current->value < hi) {
+					values.push_back(current->value);
+					current = current->next.load(std::memory_order_acquire);
+				}
+				if(!mutex.read_retry(s)) {
+					return values;
+				}
+			}
+		}
+};
+
+#endif // lacpp_sl_hpp_9
@@ -0,0 +1,621 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "epoch.hpp"
+#include "locks.hpp"
+#include "node_pool.hpp"
+#ifndef lacpp_sl_policy_hpp
+#define lacpp_sl_policy_hpp lacpp_sl_policy_hpp
+
+/* policy-based sorted list: lacpp::sorted_list<T, Lock, Granularity, Alloc>
+ *
+ * One template instead of one header per lock, so every combination can
+ * live in the same binary. Lock is any BasicLockable type (std::mutex,
+ * lacpp::tatas_lock, lacpp::mcs_mutex, ...), Granularity one of the tags
+ * below. Everything is resolved at compile time; there are no virtual
+ * calls or runtime switches on the hot path.
+ *
+ *   coarse          one lock around the whole list (sl_par_1/3)
+ *   hand_over_hand  a lock per node, coupled during traversal (sl_par_2/4/5)
+ *   optimistic      traverse without locks, lock pred/curr, then validate
+ *                   by re-traversal (Herlihy and Shavit, ch. 9.7)
+ */
+
+namespace lacpp {
+
+struct coarse {};
+struct hand_over_hand {};
+struct optimistic {};
+
+template<typename T>
+struct plain_node {
+	T				value;
+	plain_node<T>*	next;
+};
+
+template<typename T, typename Lock>
+struct alignas(CACHELINE_SIZE) locked_node {
+	T					value;
+	locked_node<T, Lock>*	next;
+	Lock				mutex;
+};
+
+template<typename T, typename Lock>
+struct alignas(CACHELINE_SIZE) optimistic_node {
+	T										value;
+	std::atomic<optimistic_node<T, Lock>*>	next{nullptr};
+	Lock									mutex;
+};
+
+template<typename T, typename Lock = std::mutex, typename Granularity = hand_over_hand, typename Alloc = heap_allocator>
+class sorted_list;
+
+/* coarse-grained: one lock for the whole list */
+template<typename T, typename Lock, typename Alloc>
+class sorted_list<T, Lock, coarse, Alloc> {
+	typedef plain_node<T> node;
+
+	node*	first = nullptr;
+	Lock	mutex;
+
+	/* free a detached chain of nodes in one pass */
+	static void free_chain(node* current) {
+		while(current != nullptr) {
+			node* next = current->next;
+			Alloc::deallocate(current);
+			current = next;
+		}
+	}
+
+public:
+	sorted_list() = default;
+	sorted_list(const sorted_list&) = delete;
+	sorted_list& operator=(const sorted_list&) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * nodes are allocated in list order, so neighbours tend to be adjacent
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		node** link = &first;
+		for(auto& v : values) {
+			node* current = Alloc::template allocate<node>();
+			current->value = v;
+			*link = current;
+			link = &current->next;
+		}
+		*link = nullptr;
+	}
+	~sorted_list() {
+		free_chain(first);
+	}
+
+	/* remove all elements; the chain is detached under the lock and freed
+	 * after releasing it
+	 */
+	void clear() {
+		node* chain;
+		{
+			std::lock_guard<Lock> lock(mutex);
+			chain = first;
+			first = nullptr;
+		}
+		free_chain(chain);
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		std::lock_guard<Lock> lock(mutex);
+		/* first find position */
+		node* pred = nullptr;
+		node* succ = first;
+		while(succ != nullptr && succ->value < v) {
+			pred = succ;
+			succ = succ->next;
+		}
+
+		/* construct new node */
+		node* current = Alloc::template allocate<node>();
+		current->value = v;
+
+		/* insert new node between pred and succ */
+		current->next = succ;
+		if(pred == nullptr) {
+			first = current;
+		} else {
+			pred->next = current;
+		}
+	}
+
+	void remove(T v) {
+		node* current;
+		{
+			std::lock_guard<Lock> lock(mutex);
+			/* first find position */
+			node* pred = nullptr;
+			current = first;
+			while(current != nullptr && current->value < v) {
+				pred = current;
+				current = current->next;
+			}
+			if(current == nullptr || current->value != v) {
+				/* v not found */
+				return;
+			}
+			/* remove current */
+			if(pred == nullptr) {
+				first = current->next;
+			} else {
+				pred->next = current->next;
+			}
+		}
+		Alloc::deallocate(current);
+	}
+
+	/* count elements with value v in the list */
+	std::size_t count(T v) {
+		std::lock_guard<Lock> lock(mutex);
+		std::size_t cnt = 0;
+		/* first go to value v */
+		node* current = first;
+		while(current != nullptr && current->value < v) {
+			current = current->next;
+		}
+		/* count elements */
+		while(current != nullptr && current->value == v) {
+			cnt++;
+			current = current->next;
+		}
+		return cnt;
+	}
+
+	/* call fn(value) for each element with lo <= value < hi, in order;
+	 * fn must not call back into the list
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		std::lock_guard<Lock> lock(mutex);
+		node* current = first;
+		while(current != nullptr && current->value < lo) {
+			current = current->next;
+		}
+		while(current != nullptr && current->value < hi) {
+			fn(current->value);
+			current = current->next;
+		}
+	}
+
+	/* count elements with lo <= value < hi */
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	/* the elements with lo <= value < hi, in order, as of one point in time */
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> values;
+		for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+		return values;
+	}
+};
+
+/* fine-grained: hand-over-hand lock coupling */
+template<typename T, typename Lock, typename Alloc>
+class sorted_list<T, Lock, hand_over_hand, Alloc> {
+	typedef locked_node<T, Lock> node;
+
+	node*	head = nullptr;
+	Lock	head_mutex;
+
+	/* free a detached chain of nodes in one pass */
+	static void free_chain(node* current) {
+		while(current != nullptr) {
+			node* next = current->next;
+			Alloc::deallocate(current);
+			current = next;
+		}
+	}
+
+public:
+	sorted_list() = default;
+	sorted_list(const sorted_list&) = delete;
+	sorted_list& operator=(const sorted_list&) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * nodes are allocated in list order, so neighbours tend to be adjacent
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		node** link = &head;
+		for(auto& v : values) {
+			node* current = Alloc::template allocate<node>();
+			current->value = v;
+			*link = current;
+			link = &current->next;
+		}
+		*link = nullptr;
+	}
+	~sorted_list() {
+		free_chain(head);
+	}
+
+	/* remove all elements in one pass: detach the chain under the head lock,
+	 * then follow it hand-over-hand, so threads still working in it stay
+	 * ahead of us and every node is freed once they have left it
+	 */
+	void clear() {
+		head_mutex.lock();
+		node* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+		head = nullptr;
+		head_mutex.unlock();
+
+		while(curr != nullptr) {
+			node* next = curr->next;
+			if (next != nullptr) next->mutex.lock();
+			curr->mutex.unlock();
+			Alloc::deallocate(curr);
+			curr = next;
+		}
+	}
+
+	void insert(T v) {
+		head_mutex.lock();
+		node* pred = nullptr;
+		node* succ = head;
+		if (succ != nullptr) succ->mutex.lock();
+
+		while(succ != nullptr && succ->value < v) {
+			if (pred == nullptr) head_mutex.unlock();
+			else pred->mutex.unlock();
+			pred = succ;
+			if (succ->next != nullptr) succ->next->mutex.lock();
+			succ = succ->next;
+		}
+
+		/* construct new node */
+		node* new_node = Alloc::template allocate<node>();
+		new_node->value = v;
+
+		/* insert new node between pred and succ */
+		new_node->next = succ;
+		if(pred == nullptr) {
+			head = new_node;
+			head_mutex.unlock();
+		} else {
+			pred->next = new_node;
+			pred->mutex.unlock();
+		}
+		if (succ != nullptr) succ->mutex.unlock();
+	}
+
+	void remove(T v) {
+		head_mutex.lock();
+		node* pred = nullptr;
+		node* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+
+		while(curr != nullptr && curr->value < v) {
+			if (pred == nullptr) head_mutex.unlock();
+			else pred->mutex.unlock();
+			pred = curr;
+			if (curr->next != nullptr) curr->next->mutex.lock();
+			curr = curr->next;
+		}
+
+		if(curr == nullptr || curr->value != v)
+		{
+			if (pred != nullptr) pred->mutex.unlock();
+			else head_mutex.unlock();
+			if (curr != nullptr) curr->mutex.unlock();
+			return;
+		}
+
+		if(pred == nullptr) {
+			head = curr->next;
+			head_mutex.unlock();
+		} else {
+			pred->next = curr->next;
+			pred->mutex.unlock();
+		}
+
+		curr->mutex.unlock();
+		Alloc::deallocate(curr);
+	}
+
+	/* count elements with value v in the list */
+	std::size_t count(T v) {
+		std::size_t cnt = 0;
+		Lock* held = &head_mutex;
+		held->lock();
+		node* curr = head;
+
+		while(curr != nullptr && curr->value < v) {
+			curr->mutex.lock();
+			held->unlock();
+			held = &curr->mutex;
+			curr = curr->next;
+		}
+
+		/* count elements */
+		while(curr != nullptr && curr->value == v) {
+			curr->mutex.lock();
+			held->unlock();
+			held = &curr->mutex;
+			cnt++;
+			curr = curr->next;
+		}
+
+		held->unlock();
+		return cnt;
+	}
+
+	/* call fn(value) for each element with lo <= value < hi, in order, as one
+	 * atomic step: every node of the range stays locked until the end, so
+	 * the values seen are the state at the moment the last one was locked.
+	 * fn runs under the node locks and must not call back into the list.
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		head_mutex.lock();
+		node* pred = nullptr;
+		node* curr = head;
+		if (curr != nullptr) curr->mutex.lock();
+
+		while(curr != nullptr && curr->value < lo) {
+			if (pred == nullptr) head_mutex.unlock();
+			else pred->mutex.unlock();
+			pred = curr;
+			if (curr->next != nullptr) curr->next->mutex.lock();
+			curr = curr->next;
+		}
+
+		/* pred and curr are locked: lock the rest of the range without releasing */
+		node* first = curr;
+		while(curr != nullptr && curr->value < hi) {
+			fn(curr->value);
+			if (curr->next != nullptr) curr->next->mutex.lock();
+			curr = curr->next;
+		}
+
+		/* release pred, the range and the node after it */
+		if (pred == nullptr) head_mutex.unlock();
+		else pred->mutex.unlock();
+		while(first != curr) {
+			node* next = first->next;
+			first->mutex.unlock();
+			first = next;
+		}
+		if (curr != nullptr) curr->mutex.unlock();
+	}
+
+	/* count elements with lo <= value < hi */
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	/* the elements with lo <= value < hi, in order, as of one point in time */
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> values;
+		for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+		return values;
+	}
+};
+
+/* fine-grained: optimistic traversal, lock pred/curr and validate */
+template<typename T, typename Lock, typename Alloc>
+class sorted_list<T, Lock, optimistic, Alloc> {
+	typedef optimistic_node<T, Lock> node;
+
+	/* sentinel, its value is never looked at */
+	node			head;
+	epoch_domain	epoch;
+
+	/* find pred, curr with pred->value < v <= curr->value without locking */
+	void find(T v, node*& pred, node*& curr) {
+		pred = &head;
+		curr = head.next.load(std::memory_order_acquire);
+		while(curr != nullptr && curr->value < v) {
+			pred = curr;
+			curr = curr->next.load(std::memory_order_acquire);
+		}
+	}
+
+	/* pred is still reachable and points to curr; pred must be locked */
+	bool validate(node* pred, node* curr) {
+		if(pred != &head) {
+			node* n = head.next.load(std::memory_order_acquire);
+			while(n != nullptr && n != pred && !(pred->value < n->value)) {
+				n = n->next.load(std::memory_order_acquire);
+			}
+			if(n != pred) {
+				return false;
+			}
+		}
+		return pred->next.load(std::memory_order_acquire) == curr;
+	}
+
+public:
+	sorted_list() = default;
+	sorted_list(const sorted_list&) = delete;
+	sorted_list& operator=(const sorted_list&) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n);
+	 * nodes are allocated in list order, so neighbours tend to be adjacent
+	 */
+	template<typename InputIt>
+	sorted_list(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		std::atomic<node*>* link = &head.next;
+		for(auto& v : values) {
+			node* current = Alloc::template allocate<node>();
+			current->value = v;
+			link->store(current, std::memory_order_relaxed);
+			link = &current->next;
+		}
+		link->store(nullptr, std::memory_order_relaxed);
+	}
+	~sorted_list() {
+		/* no concurrent users left: free the chain directly */
+		node* curr = head.next.load();
+		while(curr != nullptr) {
+			node* next = curr->next.load();
+			Alloc::deallocate(curr);
+			curr = next;
+		}
+	}
+
+	/* remove all elements in one pass: detach the chain under the sentinel's
+	 * lock, then follow it hand-over-hand so writers that validated before
+	 * the cut finish first. Writers that lock a node afterwards fail
+	 * validation, and readers may still be in the chain, so nodes are
+	 * retired rather than freed.
+	 */
+	void clear() {
+		epoch_guard guard(epoch);
+		head.mutex.lock();
+		node* curr = head.next.load(std::memory_order_relaxed);
+		if(curr != nullptr) curr->mutex.lock();
+		head.next.store(nullptr, std::memory_order_release);
+		head.mutex.unlock();
+
+		while(curr != nullptr) {
+			node* next = curr->next.load(std::memory_order_relaxed);
+			if(next != nullptr) next->mutex.lock();
+			curr->mutex.unlock();
+			epoch.retire_to<Alloc>(curr);
+			curr = next;
+		}
+	}
+
+	/* insert v into the list */
+	void insert(T v) {
+		/* construct new node */
+		node* new_node = Alloc::template allocate<node>();
+		new_node->value = v;
+
+		epoch_guard guard(epoch);
+		while(true) {
+			node* pred;
+			node* curr;
+			find(v, pred, curr);
+			std::lock_guard<Lock> pred_lock(pred->mutex);
+			if(validate(pred, curr)) {
+				/* insert new node between pred and curr */
+				new_node->next.store(curr, std::memory_order_relaxed);
+				pred->next.store(new_node, std::memory_order_release);
+				return;
+			}
+		}
+	}
+
+	void remove(T v) {
+		epoch_guard guard(epoch);
+		while(true) {
+			node* pred;
+			node* curr;
+			find(v, pred, curr);
+			if(curr == nullptr || curr->value != v) {
+				/* v not found */
+				return;
+			}
+			std::lock_guard<Lock> pred_lock(pred->mutex);
+			std::lock_guard<Lock> curr_lock(curr->mutex);
+			if(validate(pred, curr)) {
+				pred->next.store(curr->next.load(std::memory_order_relaxed), std::memory_order_release);
+				epoch.retire_to<Alloc>(curr);
+				return;
+			}
+		}
+	}
+
+	/* count elements with value v in the list */
+	std::size_t count(T v) {
+		epoch_guard guard(epoch);
+		while(true) {
+			node* pred;
+			node* curr;
+			find(v, pred, curr);
+			pred->mutex.lock();
+			if(!validate(pred, curr)) {
+				pred->mutex.unlock();
+				continue;
+			}
+			/* pred is locked and valid: count the run hand-over-hand */
+			std::size_t cnt = 0;
+			Lock* held = &pred->mutex;
+			while(curr != nullptr && curr->value == v) {
+				curr->mutex.lock();
+				held->unlock();
+				held = &curr->mutex;
+				cnt++;
+				curr = curr->next.load(std::memory_order_acquire);
+			}
+			held->unlock();
+			return cnt;
+		}
+	}
+
+	/* call fn(value) for each element with lo <= value < hi, in order, as one
+	 * atomic step: after validating pred, every node of the range is locked
+	 * and stays locked until the end. fn runs under the node locks and must
+	 * not call back into the list.
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		epoch_guard guard(epoch);
+		node* pred;
+		node* curr;
+		while(true) {
+			find(lo, pred, curr);
+			pred->mutex.lock();
+			if(validate(pred, curr)) {
+				break;
+			}
+			pred->mutex.unlock();
+		}
+
+		/* nothing can be linked in after a locked node or unlinked behind it */
+		node* first = curr;
+		while(curr != nullptr && curr->value < hi) {
+			curr->mutex.lock();
+			fn(curr->value);
+			curr = curr->next.load(std::memory_order_acquire);
+		}
+
+		pred->mutex.unlock();
+		while(first != curr) {
+			node* next = first->next.load(std::memory_order_relaxed);
+			first->mutex.unlock();
+			first = next;
+		}
+	}
+
+	/* count elements with lo <= value < hi */
+	std::size_t count_range(T lo, T hi) {
+		std::size_t cnt = 0;
+		for_each_in_range(lo, hi, [&cnt](const T&) { cnt++; });
+		return cnt;
+	}
+
+	/* the elements with lo <= value < hi, in order, as of one point in time */
+	std::vector<T> snapshot_range(T lo, T hi) {
+		std::vector<T> values;
+		for_each_in_range(lo, hi, [&values](const T& v) { values.push_back(v); });
+		return values;
+	}
+};
+
+} // namespace lacpp
+
+#endif // lacpp_sl_policy_hpp
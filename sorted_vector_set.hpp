@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "epoch.hpp"
+#include "locks.hpp"
+#ifndef lacpp_sorted_vector_set_hpp
+#define lacpp_sorted_vector_set_hpp lacpp_sorted_vector_set_hpp
+
+/* sorted multiset in one contiguous array
+ *
+ * For a few hundred elements a search over an array beats chasing
+ * pointers by far: count() is a branchless binary search followed by a
+ * vector compare over the run of equal values (AVX2 when compiled with
+ * -mavx2, SSE2 otherwise on x86-64, scalar elsewhere). Writers serialize
+ * on a seq_lock and shift the tail with memmove; readers take no lock,
+ * they read under the sequence number and retry if a writer ran.
+ *
+ * Readers may thus see a half-shifted array, but never leave it: they
+ * clamp to the capacity of the block they loaded, and a block outgrown by
+ * the set is retired through the epoch domain. The racy reads are the
+ * usual seqlock ones, hidden from ThreadSanitizer since their results are
+ * discarded whenever a writer interfered.
+ */
+
+#if defined(__SANITIZE_THREAD__)
+#define LACPP_SEQLOCK_READ __attribute__((no_sanitize_thread))
+#else
+#define LACPP_SEQLOCK_READ
+#endif
+
+/* number of leading elements of p[0, n) equal to v */
+template<typename T>
+LACPP_SEQLOCK_READ
+inline std::size_t count_run(const T* p, std::size_t n, T v) {
+	std::size_t cnt = 0;
+	while(cnt < n && p[cnt] == v) {
+		cnt++;
+	}
+	return cnt;
+}
+
+#if defined(__SSE2__)
+LACPP_SEQLOCK_READ
+inline std::size_t count_run(const int* p, std::size_t n, int v) {
+	std::size_t cnt = 0;
+#if defined(__AVX2__)
+	const __m256i key8 = _mm256_set1_epi32(v);
+	for(; cnt + 8 <= n; cnt += 8) {
+		__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + cnt));
+		unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(chunk, key8));
+		if(mask != 0xffffffffu) {
+			/* four mask bits per lane */
+			return cnt + __builtin_ctz(~mask) / 4;
+		}
+	}
+#endif
+	const __m128i key4 = _mm_set1_epi32(v);
+	for(; cnt + 4 <= n; cnt += 4) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + cnt));
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi32(chunk, key4));
+		if(mask != 0xffffu) {
+			return cnt + __builtin_ctz(~mask) / 4;
+		}
+	}
+	while(cnt < n && p[cnt] == v) {
+		cnt++;
+	}
+	return cnt;
+}
+#endif
+
+/* first index in the sorted p[0, n) with p[i] >= v, without branching on
+ * the data: the compiler turns the step into a conditional move
+ */
+template<typename T>
+LACPP_SEQLOCK_READ
+inline std::size_t branchless_lower_bound(const T* p, std::size_t n, T v) {
+	if(n == 0) {
+		return 0;
+	}
+	const T* base = p;
+	while(n > 1) {
+		std::size_t half = n / 2;
+		base = base[half] < v ? base + half : base;
+		n -= half;
+	}
+	return (base - p) + (*base < v);
+}
+
+template<typename T>
+class sorted_vector_set {
+	static_assert(std::is_trivially_copyable<T>::value, "values are moved with memmove");
+
+	static const std::size_t MIN_CAPACITY = 64;
+
+	/* header and values in one allocation */
+	struct block {
+		std::size_t	capacity;
+
+		T* values() { return reinterpret_cast<T*>(this + 1); }
+		static block* make(std::size_t capacity) {
+			block* b = static_cast<block*>(::operator new(sizeof(block) + capacity * sizeof(T)));
+			b->capacity = capacity;
+			return b;
+		}
+		static void destroy(void* p) { ::operator delete(p); }
+	};
+	static_assert(sizeof(block) % alignof(T) == 0, "values must be aligned after the header");
+
+	std::atomic<block*>			data;
+	std::atomic<std::size_t>	size{0};
+	lacpp::seq_lock				mutex;
+	epoch_domain				epoch;
+
+	/* make room for one more value; mutex must be held */
+	void reserve_one() {
+		block* b = data.load(std::memory_order_relaxed);
+		std::size_t n = size.load(std::memory_order_relaxed);
+		if(n < b->capacity) {
+			return;
+		}
+		block* grown = block::make(2 * b->capacity);
+		std::memcpy(grown->values(), b->values(), n * sizeof(T));
+		data.store(grown, std::memory_order_release);
+		/* readers may still be scanning the old block */
+		epoch_guard guard(epoch);
+		epoch.retire(b, &block::destroy);
+	}
+
+	/* copy of the values in [lo, hi), all from one version of the set */
+	LACPP_SEQLOCK_READ
+	std::vector<T> read_range(T lo, T hi) {
+		epoch_guard guard(epoch);
+		std::vector<T> out;
+		while(true) {
+			unsigned long s = mutex.read_begin();
+			block* b = data.load(std::memory_order_acquire);
+			std::size_t n = std::min(size.load(std::memory_order_relaxed), b->capacity);
+			const T* p = b->values();
+			std::size_t first = branchless_lower_bound(p, n, lo);
+			std::size_t last = first + branchless_lower_bound(p + first, n - first, hi);
+			/* load each value here: a memcpy would be checked by ThreadSanitizer */
+			out.clear();
+			for(std::size_t i = first; i < last; i++) {
+				T v = p[i];
+				out.push_back(v);
+			}
+			if(!mutex.read_retry(s)) {
+				return out;
+			}
+		}
+	}
+
+public:
+	sorted_vector_set() : data(block::make(MIN_CAPACITY)) {}
+	sorted_vector_set(const sorted_vector_set&) = delete;
+	sorted_vector_set& operator=(const sorted_vector_set&) = delete;
+
+	/* build from the values in [begin, end), sorted or not, in O(n log n) */
+	template<typename InputIt>
+	sorted_vector_set(InputIt begin, InputIt end) {
+		std::vector<T> values(begin, end);
+		std::sort(values.begin(), values.end());
+		std::size_t capacity = 2 * values.size();
+		block* b = block::make(capacity < MIN_CAPACITY ? MIN_CAPACITY : capacity);
+		std::copy(values.begin(), values.end(), b->values());
+		data.store(b, std::memory_order_relaxed);
+		size.store(values.size(), std::memory_order_relaxed);
+	}
+	~sorted_vector_set() {
+		block::destroy(data.load());
+	}
+
+	/* remove all elements; the buffer is kept */
+	void clear() {
+		mutex.lock();
+		size.store(0, std::memory_order_relaxed);
+		mutex.unlock();
+	}
+
+	/* insert v into the set */
+	void insert(T v) {
+		mutex.lock();
+		reserve_one();
+		block* b = data.load(std::memory_order_relaxed);
+		std::size_t n = size.load(std::memory_order_relaxed);
+		T* p = b->values();
+		std::size_t i = branchless_lower_bound(p, n, v);
+		std::memmove(p + i + 1, p + i, (n - i) * sizeof(T));
+		p[i] = v;
+		size.store(n + 1, std::memory_order_relaxed);
+		mutex.unlock();
+	}
+
+	void remove(T v) {
+		mutex.lock();
+		block* b = data.load(std::memory_order_relaxed);
+		std::size_t n = size.load(std::memory_order_relaxed);
+		T* p = b->values();
+		std::size_t i = branchless_lower_bound(p, n, v);
+		if(i < n && p[i] == v) {
+			std::memmove(p + i, p + i + 1, (n - i - 1) * sizeof(T));
+			size.store(n - 1, std::memory_order_relaxed);
+		}
+		mutex.unlock();
+	}
+
+	/* count elements with value v, retrying if a writer intervened */
+	LACPP_SEQLOCK_READ
+	std::size_t count(T v) {
+		epoch_guard guard(epoch);
+		while(true) {
+			unsigned long s = mutex.read_begin();
+			block* b = data.load(std::memory_order_acquire);
+			std::size_t n = std::min(size.load(std::memory_order_relaxed), b->capacity);
+			const T* p = b->values();
+			std::size_t i = branchless_lower_bound(p, n, v);
+			std::size_t cnt = count_run(p + i, n - i, v);
+			if(!mutex.read_retry(s)) {
+				return cnt;
+			}
+		}
+	}
+
+	/* call fn on every element with lo <= value < hi, in order, all taken
+	 * from one version of the set
+	 */
+	template<typename F>
+	void for_each_in_range(T lo, T hi, F fn) {
+		for(auto& v : read_range(lo, hi)) {
+			fn(v);
+		}
+	}
+
+	std::size_t count_range(T lo, T hi) {
+		return read_range(lo, hi).size();
+	}
+
+	std::vector<T> snapshot_range(T lo, T hi) {
+		return read_range(lo, hi);
+	}
+};
+
+#endif // lacpp_sorted_vector_set_hpp
@@ -0,0 +1,75 @@
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <vector>
+#ifndef lacpp_thread_index_hpp
+#define lacpp_thread_index_hpp lacpp_thread_index_hpp
+
+/* small dense per-thread indices, used to address per-thread slots
+ * (epoch records, reader counters, publication slots, ...)
+ *
+ * Indices are handed back when a thread exits, so the benchmark spawning
+ * fresh workers for every run keeps reusing the same low slots.
+ */
+
+#ifndef CACHELINE_SIZE
+#define CACHELINE_SIZE 64
+#endif
+
+static const std::size_t MAX_THREADS = 256;
+
+class thread_index_registry {
+	std::mutex				mutex;
+	std::vector<std::size_t>	free_ids;
+	std::size_t				next = 0;
+	std::atomic<std::size_t>	high{0};
+
+public:
+	static thread_index_registry& instance() {
+		static thread_index_registry registry;
+		return registry;
+	}
+
+	std::size_t acquire() {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::size_t id;
+		if(!free_ids.empty()) {
+			id = free_ids.back();
+			free_ids.pop_back();
+		} else {
+			id = next++;
+		}
+		if(id >= MAX_THREADS) {
+			/* out of slots: more live threads than MAX_THREADS */
+			std::terminate();
+		}
+		if(id + 1 > high.load(std::memory_order_relaxed)) {
+			high.store(id + 1, std::memory_order_release);
+		}
+		return id;
+	}
+
+	void release(std::size_t id) {
+		std::lock_guard<std::mutex> lock(mutex);
+		free_ids.push_back(id);
+	}
+
+	/* one past the largest index ever handed out */
+	std::size_t high_water() const { return high.load(std::memory_order_acquire); }
+};
+
+struct thread_index_holder {
+	std::size_t id;
+
+	thread_index_holder() : id(thread_index_registry::instance().acquire()) {}
+	~thread_index_holder() { thread_index_registry::instance().release(id); }
+};
+
+/* index of the calling thread, in [0, MAX_THREADS) */
+inline std::size_t thread_index() {
+	static thread_local thread_index_holder holder;
+	return holder.id;
+}
+
+#endif // lacpp_thread_index_hpp